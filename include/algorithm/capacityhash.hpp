@@ -0,0 +1,323 @@
+#ifndef __CAPACITY_HASH_H__
+#define __CAPACITY_HASH_H__
+#include <stdexcept>
+#include <algorithm>
+#include <cstddef>
+#include <map>
+#include <set>
+#include <utility>
+#include <vector>
+#include <stdint.h>
+#include "algorithm/consthash.hpp"
+namespace algorithm
+{
+    // a const_hash whose vnode counts follow node capacities. a node gets
+    // unit * capacity vnodes, unit being kept across membership changes
+    // so nodes that did not change keep their points. unit only grows,
+    // when the measured imbalance, the largest share of keys a node owns
+    // over its share of capacity, minus one, misses the target.
+    class capacity_hash
+    {
+    public:
+        typedef std::map<int, double> capacity_map;
+
+        // imbalance is the largest excess of keys over its capacity share
+        // any node may get, 0.1 allowing 10%.
+        explicit capacity_hash(double imbalance = 0.1,
+                const_hash::layout_type layout = const_hash::flat_layout):
+            ring(layout),
+            unit(0)
+        {
+            target(imbalance);
+        }
+
+        virtual ~capacity_hash(){}
+
+        // adds a node, or changes its capacity, and rebalances.
+        virtual void add(int id, double capacity)
+        {
+            if(!(capacity > 0))
+            {
+                throw std::invalid_argument("capacity should be positive.");
+            }
+            capacity_map next(capacities);
+            next[id] = capacity;
+            rebalance(next, unit);
+        }
+
+        // replaces every node at once, searching from one vnode for the
+        // smallest capacity up. gives a smaller ring than adding the
+        // nodes one by one, which only grows unit, but may move any key.
+        virtual void assign(const capacity_map& next)
+        {
+            for(capacity_map::const_iterator c = next.begin();
+                    c != next.end(); ++c)
+            {
+                if(!(c->second > 0))
+                {
+                    throw std::invalid_argument("capacity should be "
+                            "positive.");
+                }
+            }
+            rebalance(next, 0);
+        }
+
+        virtual void erase(int id)
+        {
+            if(!capacities.count(id))
+            {
+                return;
+            }
+            capacity_map next(capacities);
+            next.erase(id);
+            rebalance(next, unit);
+        }
+
+        double capacity(int id) const
+        {
+            capacity_map::const_iterator it = capacities.find(id);
+            return it == capacities.end() ? 0 : it->second;
+        }
+
+        // vnodes chosen for a node.
+        int weight(int id) const
+        {
+            return ring.weight(id);
+        }
+
+        // takes effect at the next membership change, which grows the
+        // ring if the new target is tighter.
+        void target(double imbalance)
+        {
+            if(!(imbalance > 0))
+            {
+                throw std::range_error("imbalance should be positive.");
+            }
+            goal = imbalance;
+        }
+
+        double target() const
+        {
+            return goal;
+        }
+
+        // measured imbalance of the live ring.
+        double imbalance() const
+        {
+            return imbalance(ring, capacities);
+        }
+
+        // largest owned key share over capacity share of any node of
+        // capacities, minus one, 0 for an empty ring.
+        template<typename Hash>
+        static double imbalance(const Hash& hash,
+                const capacity_map& capacities)
+        {
+            return imbalance(hash.begin(), hash.end(),
+                    (uint64_t)Hash::MAX_POINT + 1, capacities);
+        }
+
+        int hash(double resource) const
+        {
+            return ring.hash(resource);
+        }
+
+        int hash_key(uint64_t key) const
+        {
+            return ring.hash_key(key);
+        }
+
+        int hash_key(const void* key, std::size_t len) const
+        {
+            return ring.hash_key(key, len);
+        }
+
+        virtual bool empty() const
+        {
+            return ring.empty();
+        }
+
+        virtual std::set<int> alive_set() const
+        {
+            return ring.alive_set();
+        }
+
+        alive_view<int> alive() const
+        {
+            return ring.alive();
+        }
+
+        // points on the ring.
+        std::size_t size() const
+        {
+            return ring.size();
+        }
+
+        const const_hash& points() const
+        {
+            return ring;
+        }
+
+        // ring size the search stops at, short of the target if need be.
+        const static int MAX_POINTS = 1 << 20;
+
+    private:
+        typedef std::map<int, int> weight_map;
+        typedef std::pair<const_hash::point_type, int> point_entry;
+
+        // the same over the sorted points [first, last) of a ring whose
+        // keys fall in [0, space).
+        template<typename Iterator>
+        static double imbalance(Iterator first, Iterator last,
+                uint64_t space, const capacity_map& capacities)
+        {
+            if(first == last)
+            {
+                return 0;
+            }
+            std::map<int, uint64_t> owned;
+            uint64_t previous = 0;
+            for(Iterator it = first; it != last; ++it)
+            {
+                owned[it->second] += (uint64_t)it->first + 1 - previous;
+                previous = (uint64_t)it->first + 1;
+            }
+            // keys past the last point wrap to the first one.
+            owned[first->second] += space - previous;
+
+            double total = 0;
+            for(capacity_map::const_iterator c = capacities.begin();
+                    c != capacities.end(); ++c)
+            {
+                total += c->second;
+            }
+            double worst = 0;
+            for(capacity_map::const_iterator c = capacities.begin();
+                    c != capacities.end(); ++c)
+            {
+                double share = (double)owned[c->first] / space;
+                worst = std::max(worst, share / (c->second / total));
+            }
+            return worst - 1;
+        }
+
+        // vnodes of every node at unit vnodes per capacity.
+        static weight_map weights(const capacity_map& capacities,
+                double unit)
+        {
+            weight_map counts;
+            for(capacity_map::const_iterator c = capacities.begin();
+                    c != capacities.end(); ++c)
+            {
+                double w = std::min(unit * c->second + 0.5,
+                        (double)MAX_POINTS + 1);
+                counts[c->first] = std::max((int)w, 1);
+            }
+            return counts;
+        }
+
+        // keeps start as unit if next still meets the target with it, so
+        // only nodes that changed move keys. otherwise grows it by steps
+        // of 25% until it does, or the next step would pass MAX_POINTS.
+        // a start of 0 gives the smallest capacity one vnode. throws
+        // before changing anything if even start is too many.
+        void rebalance(const capacity_map& next, double start)
+        {
+            weight_map chosen;
+            double found = 0;
+            if(!next.empty())
+            {
+                double u = start;
+                if(u == 0)
+                {
+                    double smallest = next.begin()->second;
+                    for(capacity_map::const_iterator c = next.begin();
+                            c != next.end(); ++c)
+                    {
+                        smallest = std::min(smallest, c->second);
+                    }
+                    u = 1 / smallest;
+                }
+                // trial rings as sorted vectors of the points add() would
+                // make, ignoring the few collisions it would skip.
+                std::vector<point_entry> scratch;
+                weight_map current;
+                for(;; u *= 1.25)
+                {
+                    weight_map trial = weights(next, u);
+                    std::size_t total = 0;
+                    for(weight_map::const_iterator w = trial.begin();
+                            w != trial.end(); ++w)
+                    {
+                        total += w->second;
+                    }
+                    if(total > (std::size_t)MAX_POINTS)
+                    {
+                        if(chosen.empty())
+                        {
+                            throw std::range_error("capacities need more "
+                                    "than MAX_POINTS vnodes.");
+                        }
+                        break;
+                    }
+                    std::size_t sorted = scratch.size();
+                    for(weight_map::const_iterator w = trial.begin();
+                            w != trial.end(); ++w)
+                    {
+                        for(int i = current[w->first]; i < w->second; ++i)
+                        {
+                            scratch.push_back(point_entry(
+                                        ring_point(w->first, i), w->first));
+                        }
+                    }
+                    std::sort(scratch.begin() + sorted, scratch.end());
+                    std::inplace_merge(scratch.begin(),
+                            scratch.begin() + sorted, scratch.end());
+                    current = trial;
+                    chosen = trial;
+                    found = u;
+                    if(imbalance(scratch.begin(), scratch.end(),
+                                (uint64_t)const_hash::MAX_POINT + 1, next)
+                            <= goal)
+                    {
+                        break;
+                    }
+                }
+            }
+
+            const_hash::batch changes;
+            for(capacity_map::const_iterator c = capacities.begin();
+                    c != capacities.end(); ++c)
+            {
+                if(!next.count(c->first))
+                {
+                    changes.erase(c->first);
+                }
+            }
+            for(weight_map::const_iterator w = chosen.begin();
+                    w != chosen.end(); ++w)
+            {
+                int delta = w->second - ring.weight(w->first);
+                if(delta > 0)
+                {
+                    changes.add(w->first, delta);
+                }
+                else if(delta < 0)
+                {
+                    changes.remove(w->first, -delta);
+                }
+            }
+            ring.apply(changes);
+            capacities = next;
+            unit = found;
+        }
+
+        const_hash ring;
+        capacity_map capacities;
+        double goal;
+
+        // vnodes per capacity, 0 while there are no nodes.
+        double unit;
+    };
+}
+#endif //__CAPACITY_HASH_H__
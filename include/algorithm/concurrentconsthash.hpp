@@ -0,0 +1,310 @@
+#ifndef __CONCURRENT_CONST_HASH_H__
+#define __CONCURRENT_CONST_HASH_H__
+#include <stdexcept>
+#include <cstddef>
+#include <set>
+#include <utility>
+#include <vector>
+#include <pthread.h>
+#include <stdint.h>
+#include "algorithm/consthash.hpp"
+#include "algorithm/flatring.hpp"
+namespace algorithm
+{
+    // one cache line per reader, so pinning never bounces between cores.
+    struct epoch_slot
+    {
+        uint64_t epoch;
+        int used;
+        char padding[64 - sizeof(uint64_t) - sizeof(int)];
+    } __attribute__((aligned(64)));
+
+    // epoch based reclamation shared by every concurrent ring of the
+    // process. a reader publishes the global epoch in its own slot while
+    // it holds a snapshot; a snapshot retired at epoch e is freed once
+    // no slot holds an epoch older than e.
+    class epoch_domain
+    {
+    public:
+        static epoch_domain& instance()
+        {
+            static epoch_domain domain;
+            return domain;
+        }
+
+        // pins the calling thread to the current epoch for its lifetime.
+        class guard
+        {
+        public:
+            explicit guard(epoch_domain& domain):
+                slot(domain.local())
+            {
+                __atomic_store_n(&slot->epoch,
+                        __atomic_load_n(&domain.global, __ATOMIC_SEQ_CST),
+                        __ATOMIC_SEQ_CST);
+            }
+
+            ~guard()
+            {
+                __atomic_store_n(&slot->epoch, 0, __ATOMIC_RELEASE);
+            }
+
+        private:
+            guard(const guard&);
+            guard& operator=(const guard&);
+
+            epoch_slot* slot;
+        };
+
+        // starts a new epoch and returns it. call it after unlinking
+        // what is about to be retired.
+        uint64_t advance()
+        {
+            return __atomic_add_fetch(&global, 1, __ATOMIC_SEQ_CST);
+        }
+
+        // true once no reader can still see what was retired at epoch.
+        bool quiescent(uint64_t epoch) const
+        {
+            for(int i = 0; i < MAX_THREADS; ++i)
+            {
+                uint64_t e = __atomic_load_n(&slots[i].epoch,
+                        __ATOMIC_SEQ_CST);
+                if(e != 0 && e < epoch)
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        const static int MAX_THREADS = 256;
+
+    private:
+        epoch_domain():
+            global(1)
+        {
+            for(int i = 0; i < MAX_THREADS; ++i)
+            {
+                slots[i].epoch = 0;
+                slots[i].used = 0;
+            }
+            pthread_key_create(&key, release);
+        }
+
+        // a thread keeps its slot until it exits.
+        epoch_slot* local()
+        {
+            epoch_slot* slot =
+                static_cast<epoch_slot*>(pthread_getspecific(key));
+            if(slot)
+            {
+                return slot;
+            }
+            for(int i = 0; i < MAX_THREADS; ++i)
+            {
+                int expected = 0;
+                if(__atomic_compare_exchange_n(&slots[i].used, &expected, 1,
+                            false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+                {
+                    pthread_setspecific(key, &slots[i]);
+                    return &slots[i];
+                }
+            }
+            throw std::runtime_error("too many reader threads.");
+        }
+
+        static void release(void* slot)
+        {
+            __atomic_store_n(&static_cast<epoch_slot*>(slot)->used, 0,
+                    __ATOMIC_RELEASE);
+        }
+
+        uint64_t global;
+        epoch_slot slots[MAX_THREADS];
+        pthread_key_t key;
+    };
+
+    // const_hash whose lookups never lock. readers search an immutable
+    // flat snapshot loaded through one atomic pointer; writers update a
+    // private const_hash under a mutex, publish a new snapshot and leave
+    // the old one to epoch_domain.
+    class concurrent_const_hash
+    {
+    public:
+        typedef const_hash::point_type point_type;
+        typedef const_hash::batch batch;
+
+        concurrent_const_hash():
+            current(new snapshot()),
+            domain(epoch_domain::instance())
+        {
+            pthread_mutex_init(&mutex, NULL);
+        }
+
+        // readers must be gone by now.
+        virtual ~concurrent_const_hash()
+        {
+            delete current;
+            for(std::size_t i = 0; i < retired.size(); ++i)
+            {
+                delete retired[i].second;
+            }
+            pthread_mutex_destroy(&mutex);
+        }
+
+        virtual void add(int id, int w)
+        {
+            lock l(mutex);
+            master.add(id, w);
+            publish();
+        }
+
+        virtual int remove(int id, int w)
+        {
+            lock l(mutex);
+            int weight = master.remove(id, w);
+            publish();
+            return weight;
+        }
+
+        virtual void erase(int id)
+        {
+            lock l(mutex);
+            master.erase(id);
+            publish();
+        }
+
+        // all of changes becomes visible to readers at once, through a
+        // single snapshot.
+        virtual void apply(const batch& changes)
+        {
+            lock l(mutex);
+            master.apply(changes);
+            publish();
+        }
+
+        virtual int weight(int id) const
+        {
+            lock l(mutex);
+            return master.weight(id);
+        }
+
+        virtual int hash(double resource) const
+        {
+            if(resource < 0 || resource > 1)
+            {
+                throw std::range_error("resource should be between 0"
+                        "and 1.");
+            }
+            return successor(const_hash::point(resource));
+        }
+
+        int hash_key(uint64_t key) const
+        {
+            return successor(const_hash::point(key));
+        }
+
+        int hash_key(const void* key, std::size_t len) const
+        {
+            return successor(const_hash::point(key, len));
+        }
+
+        virtual bool empty() const
+        {
+            epoch_domain::guard g(domain);
+            return __atomic_load_n(&current, __ATOMIC_SEQ_CST)->ring.empty();
+        }
+
+        virtual std::set<int> alive_set() const
+        {
+            epoch_domain::guard g(domain);
+            const snapshot* s = __atomic_load_n(&current, __ATOMIC_SEQ_CST);
+            return std::set<int>(s->alive.begin(), s->alive.end());
+        }
+
+        // snapshots still waiting for their readers to leave.
+        std::size_t pending() const
+        {
+            lock l(mutex);
+            return retired.size();
+        }
+
+    private:
+        struct snapshot
+        {
+            flat_ring<point_type> ring;
+            std::vector<int> alive;
+        };
+
+        class lock
+        {
+        public:
+            explicit lock(pthread_mutex_t& m):
+                mutex(m)
+            {
+                pthread_mutex_lock(&mutex);
+            }
+
+            ~lock()
+            {
+                pthread_mutex_unlock(&mutex);
+            }
+
+        private:
+            lock(const lock&);
+            lock& operator=(const lock&);
+
+            pthread_mutex_t& mutex;
+        };
+
+        int successor(point_type p) const
+        {
+            epoch_domain::guard g(domain);
+            const snapshot* s = __atomic_load_n(&current, __ATOMIC_SEQ_CST);
+            if(s->ring.empty())
+            {
+                throw std::domain_error("empty ring.");
+            }
+            return s->ring.successor(p);
+        }
+
+        // called with the mutex held.
+        void publish()
+        {
+            snapshot* next = new snapshot();
+            next->ring.assign(master.begin(), master.end());
+            alive_view<int> alive = master.alive();
+            next->alive.assign(alive.begin(), alive.end());
+
+            snapshot* old = __atomic_exchange_n(&current, next,
+                    __ATOMIC_SEQ_CST);
+            retired.push_back(std::make_pair(domain.advance(), old));
+
+            std::size_t kept = 0;
+            for(std::size_t i = 0; i < retired.size(); ++i)
+            {
+                if(domain.quiescent(retired[i].first))
+                {
+                    delete retired[i].second;
+                }
+                else
+                {
+                    retired[kept++] = retired[i];
+                }
+            }
+            retired.resize(kept);
+        }
+
+        snapshot* current;
+        epoch_domain& domain;
+
+        const_hash master;
+        std::vector<std::pair<uint64_t, snapshot*> > retired;
+        mutable pthread_mutex_t mutex;
+
+        concurrent_const_hash(const concurrent_const_hash&);
+        concurrent_const_hash& operator=(const concurrent_const_hash&);
+    };
+}
+#endif //__CONCURRENT_CONST_HASH_H__
@@ -1,121 +1,658 @@
 #ifndef __CONST_HASH_H__
 #define __CONST_HASH_H__
 #include <stdexcept>
+#include <algorithm>
 #include <map>
 #include <set>
+#include <vector>
+#include <cmath>
+#include <stdint.h>
+#include <pthread.h>
+#include "algorithm/flatring.hpp"
+#include "algorithm/keyhash.hpp"
 namespace algorithm
 {
-    class const_hash
+    // the point generator behind const_hash::random(), the y-th point of
+    // node x. usable in constant expressions from c++14 on.
+#if __cplusplus >= 201402L
+    constexpr
+#endif
+    inline uint32_t ring_point(int x, int y)
+    {
+        unsigned int a = (unsigned int)x * 123456789u + y;
+        a -= (a<<6);
+        a ^= (a>>17);
+        a -= (a<<9);
+        a ^= (a<<4);
+        a -= (a<<3);
+        a ^= (a<<10);
+        a ^= (a>>15);
+        return a % 0x7FFFFFFF;
+    }
+
+    // the point generator of const_hash, ring_point() for 32-bit points.
+    struct ring_point_generator
+    {
+        uint32_t operator()(int id, int sequence) const
+        {
+            return ring_point(id, sequence);
+        }
+    };
+
+    // a point generator for 64-bit points and any integral node id, the
+    // top 63 bits of key_hash() seeded with the sequence.
+    struct key_hash_generator
+    {
+        template<typename NodeId>
+        uint64_t operator()(const NodeId& id, int sequence) const
+        {
+            return key_hash((uint64_t)id, (uint64_t)sequence + 1) >> 1;
+        }
+    };
+
+    // the sorted ids of the live nodes, read in place from the ring that
+    // made it. it allocates nothing and stays valid until the next
+    // membership change of that ring.
+    template<typename Id>
+    class alive_view
     {
     public:
-        const_hash(){}
-        virtual ~const_hash(){}
+        typedef Id value_type;
+        typedef const Id* const_iterator;
 
-        virtual void add(int id, int w)
+        alive_view(const Id* begin, const Id* end):
+            first(begin),
+            last(end)
         {
-            if((w + ring.size()) >= MAX_NODES)
+        }
+
+        const_iterator begin() const
+        {
+            return first;
+        }
+
+        const_iterator end() const
+        {
+            return last;
+        }
+
+        std::size_t size() const
+        {
+            return last - first;
+        }
+
+        bool empty() const
+        {
+            return first == last;
+        }
+
+        const Id& operator[](std::size_t index) const
+        {
+            return first[index];
+        }
+
+        bool contains(const Id& id) const
+        {
+            return std::binary_search(first, last, id);
+        }
+
+    private:
+        const Id* first;
+        const Id* last;
+    };
+
+    // consistent hash ring with its point type, node id type, point
+    // generator and master ring container as compile time policies, and
+    // nothing virtual. PointGenerator maps (id, sequence) to a point
+    // below MAX_POINT, Storage is a sorted unique map from points to
+    // ids. const_hash is the classic instantiation.
+    template<typename Point = uint32_t, typename NodeId = int,
+        typename PointGenerator = ring_point_generator,
+        typename Storage = std::map<Point, NodeId> >
+    class basic_const_hash
+    {
+    public:
+        // ring positions are integers in [0, MAX_POINT], the double
+        // interface maps them onto [0, 1] as point / MAX_POINT.
+        typedef Point point_type;
+        typedef NodeId id_type;
+        typedef PointGenerator generator_type;
+        typedef Storage ring_type;
+        typedef typename ring_type::const_iterator const_iterator;
+
+        // tree_layout searches the std::map directly, flat_layout keeps
+        // a sorted array image of the ring for lookups and rebuilds it
+        // on every membership change. eytzinger_layout stores that image
+        // in bfs order, for rings much larger than the cache.
+        // compact_layout stores owners as 16-bit indices into a table of
+        // ids, for up to 65536 nodes.
+        enum layout_type
+        {
+            tree_layout,
+            flat_layout,
+            eytzinger_layout,
+            compact_layout
+        };
+
+        explicit basic_const_hash(layout_type layout = tree_layout,
+                const generator_type& generator = generator_type()):
+            point_generator(generator),
+            epsilon(0.25),
+            totals(),
+            ring_layout(layout)
+        {
+        }
+
+        // membership changes recorded for apply(), replayed in order.
+        class batch
+        {
+        public:
+            void add(const id_type& id, int w)
             {
-                throw std::range_error("too many nodes");
+                operations.push_back(operation(add_operation, id, w));
             }
 
-            if(w > 0)
+            void remove(const id_type& id, int w)
             {
-                id_set.insert(id);
+                operations.push_back(operation(remove_operation, id, w));
             }
 
-            int current_weight = weight(id);
-            for(int counter = 0; counter < w;)
+            void erase(const id_type& id)
             {
-                double index = random(id, current_weight + counter);
-                if(ring.insert(std::make_pair(index, id)).second)
+                operations.push_back(operation(erase_operation, id, 0));
+            }
+
+            void clear()
+            {
+                operations.clear();
+            }
+
+            bool empty() const
+            {
+                return operations.empty();
+            }
+
+            std::size_t size() const
+            {
+                return operations.size();
+            }
+
+        private:
+            friend class basic_const_hash;
+
+            enum kind
+            {
+                add_operation,
+                remove_operation,
+                erase_operation
+            };
+
+            struct operation
+            {
+                operation(kind k, const id_type& i, int w):
+                    type(k),
+                    id(i),
+                    weight(w)
                 {
-                    counter++;
                 }
+
+                kind type;
+                id_type id;
+                int weight;
+            };
+
+            std::vector<operation> operations;
+        };
+
+        void add(const id_type& id, int w)
+        {
+            if((w + ring.size()) >= MAX_NODES)
+            {
+                throw std::range_error("too many nodes");
             }
+            if(w > 0 && !nodes.count(id))
+            {
+                reserve(1);
+            }
+            insert(id, w);
+            rebuild();
         }
 
-        virtual int remove(int id, int w)
+        int remove(const id_type& id, int w)
         {
-            int current_weight = weight(id);
+            int current_weight = take(id, w);
+            rebuild();
+            return current_weight;
+        }
 
-            w = std::min(w, current_weight);
+        void erase(const id_type& id)
+        {
+            if(drop(id))
+            {
+                rebuild();
+            }
+        }
 
-            for(int counter = 0; counter < w;)
+        // applies every operation of changes as if add(), remove() and
+        // erase() were called in turn, but rebuilds the lookup layout
+        // once. throws before changing anything if the additions could
+        // overflow the ring or the compact layout.
+        void apply(const batch& changes)
+        {
+            std::size_t added = 0;
+            std::set<id_type> joining;
+            for(operation_iterator it = changes.operations.begin();
+                    it != changes.operations.end(); ++it)
             {
-                double index = random(id, current_weight - 1);
-                ring_type::iterator 
-                    begin = ring.lower_bound(index),
-                          end = ring.end();
-                if(begin == end)
+                if(it->type == batch::add_operation && it->weight > 0)
                 {
-                    begin = ring.begin();
+                    added += it->weight;
+                    if(!nodes.count(it->id))
+                    {
+                        joining.insert(it->id);
+                    }
                 }
+            }
+            if(added + ring.size() >= (std::size_t)MAX_NODES)
+            {
+                throw std::range_error("too many nodes");
+            }
+            reserve(joining.size());
 
-                for(ring_type::iterator it = begin; it!=end;
-                        ++it)
+            for(operation_iterator it = changes.operations.begin();
+                    it != changes.operations.end(); ++it)
+            {
+                switch(it->type)
                 {
-                    if(it->second == id)
-                    {
-                        ring.erase(it);
-                        --current_weight;
-                        ++counter;
-                        break;
-                    }
+                case batch::add_operation:
+                    insert(it->id, it->weight);
+                    break;
+                case batch::remove_operation:
+                    take(it->id, it->weight);
+                    break;
+                case batch::erase_operation:
+                    drop(it->id);
+                    break;
                 }
             }
-            if(current_weight == 0)
+            rebuild();
+        }
+
+        int weight(const id_type& id) const
+        {
+            typename node_map::const_iterator node = nodes.find(id);
+            if(node == nodes.end())
             {
-                id_set.erase(id);
+                return 0;
             }
-            return current_weight;
+            return node->second.points.size();
         }
 
-        virtual void erase(int id)
+        id_type hash(double resource) const
         {
-            for(ring_type::iterator it = ring.begin();
-                    it != ring.end();)
+            if(resource < 0 || resource > 1)
+            {
+                throw std::range_error("resource should be between 0" 
+                        "and 1.");
+            }
+
+            if(empty())
             {
-                if(it->second == id)
+                throw std::domain_error("empty ring.");
+            }
+
+            return successor(point(resource));
+        }
+
+        id_type hash_key(uint64_t key) const
+        {
+            if(empty())
+            {
+                throw std::domain_error("empty ring.");
+            }
+            return successor(point(key));
+        }
+
+        id_type hash_key(const void* key, std::size_t len) const
+        {
+            if(empty())
+            {
+                throw std::domain_error("empty ring.");
+            }
+            return successor(point(key, len));
+        }
+
+        // hash_key(keys[i]) for n keys, written to out[i]. the flat layout
+        // interleaves the searches of a batch.
+        void hash_many(const uint64_t* keys, std::size_t n,
+                id_type* out) const
+        {
+            if(empty())
+            {
+                throw std::domain_error("empty ring.");
+            }
+
+            point_type points[batch_size];
+            for(std::size_t start = 0; start < n; start += batch_size)
+            {
+                std::size_t m = std::min(n - start, (std::size_t)batch_size);
+                for(std::size_t i = 0; i < m; ++i)
                 {
-                    ring_type::iterator to_erase = it++;
-                    ring.erase(to_erase);
+                    points[i] = point(keys[start + i]);
                 }
-                else
+                if(ring_layout == flat_layout)
                 {
-                    ++it;
+                    flat.successors(points, m, out + start);
+                    continue;
+                }
+                for(std::size_t i = 0; i < m; ++i)
+                {
+                    out[start + i] = successor(points[i]);
                 }
             }
-            id_set.erase(id);
         }
 
-        virtual int weight(int id) const
+        // the first k distinct nodes clockwise from key, written to out.
+        // returns how many were written, at most the number of nodes.
+        // the flat layout follows its next_owner() links, so long runs
+        // of one node's points are skipped in one step.
+        std::size_t hash_n(uint64_t key, std::size_t k, id_type* out) const
+        {
+            return successors(point(key), k, out);
+        }
+
+        std::size_t hash_n(const void* key, std::size_t len, std::size_t k,
+                id_type* out) const
+        {
+            return successors(point(key, len), k, out);
+        }
+
+        // bounded loads: callers report the keys they place on a node
+        // with assign() and drop with release(). hash_bounded() then
+        // walks clockwise past nodes whose load has reached
+        // ceil((1 + load_factor) * (total load + 1) / nodes). these may
+        // be called from many threads at once, but not while the
+        // membership changes. each node's load has a cache line of its
+        // own, in an array parallel to the sorted ids, and the total is
+        // split over load_shards lines by calling thread, so threads
+        // placing keys on different nodes share a line only when their
+        // threads land on the same shard.
+        void load_factor(double factor)
+        {
+            if(!(factor >= 0))
+            {
+                throw std::range_error("load factor should not be "
+                        "negative.");
+            }
+            epsilon = factor;
+        }
+
+        double load_factor() const
+        {
+            return epsilon;
+        }
+
+        void assign(const id_type& id)
         {
-            int weight = 0;
-            for(ring_type::const_iterator it = ring.begin(),
-                    end = ring.end(); it != end; ++it)
+            std::size_t slot = slot_of(id);
+            if(slot == alive_ids.size())
             {
-                if(it->second == id)
+                throw std::invalid_argument("node not in ring.");
+            }
+            __atomic_add_fetch(&loads[slot].value, 1, __ATOMIC_RELAXED);
+            __atomic_add_fetch(&totals[shard()].value, 1, __ATOMIC_RELAXED);
+        }
+
+        // returns false, leaving the load at zero, if the node had none.
+        bool release(const id_type& id)
+        {
+            std::size_t slot = slot_of(id);
+            if(slot == alive_ids.size())
+            {
+                throw std::invalid_argument("node not in ring.");
+            }
+            long current = __atomic_load_n(&loads[slot].value,
+                    __ATOMIC_RELAXED);
+            do
+            {
+                if(current <= 0)
                 {
-                    ++weight;
+                    return false;
                 }
             }
-            return weight;
+            while(!__atomic_compare_exchange_n(&loads[slot].value, &current,
+                        current - 1, true, __ATOMIC_RELAXED,
+                        __ATOMIC_RELAXED));
+            __atomic_sub_fetch(&totals[shard()].value, 1, __ATOMIC_RELAXED);
+            return true;
         }
 
-        virtual int hash(double resource) const
+        long load(const id_type& id) const
         {
-            if(resource < 0 || resource > 1)
+            std::size_t slot = slot_of(id);
+            if(slot == alive_ids.size())
             {
-                throw std::range_error("resource should be between 0" 
-                        "and 1.");
+                return 0;
+            }
+            return __atomic_load_n(&loads[slot].value, __ATOMIC_RELAXED);
+        }
+
+        long total_load() const
+        {
+            long sum = 0;
+            for(int i = 0; i < load_shards; ++i)
+            {
+                sum += __atomic_load_n(&totals[i].value, __ATOMIC_RELAXED);
+            }
+            return sum;
+        }
+
+        id_type hash_bounded(uint64_t key) const
+        {
+            if(empty())
+            {
+                throw std::domain_error("empty ring.");
             }
+            return bounded_successor(point(key));
+        }
 
+        id_type hash_bounded(const void* key, std::size_t len) const
+        {
             if(empty())
             {
                 throw std::domain_error("empty ring.");
             }
+            return bounded_successor(point(key, len));
+        }
+
+        bool empty() const
+        {
+            return ring.empty();
+        }
+
+        std::set<id_type> alive_set() const
+        {
+            return std::set<id_type>(alive_ids.begin(), alive_ids.end());
+        }
+
+        // the live node ids without copying them, see alive_view.
+        alive_view<id_type> alive() const
+        {
+            const id_type* first = alive_ids.empty() ? NULL : &alive_ids[0];
+            return alive_view<id_type>(first, first + alive_ids.size());
+        }
+
+        layout_type layout() const
+        {
+            return ring_layout;
+        }
+
+        // splits the point space of the flat layout into 2^bits buckets,
+        // each knowing its first ring index, so most lookups read one
+        // table entry and search a handful of points. 0 turns it off.
+        void bucket_bits(int bits)
+        {
+            if(ring_layout != flat_layout)
+            {
+                throw std::logic_error("bucket table needs flat layout.");
+            }
+            if(bits < 0 || bits > MAX_BUCKET_BITS)
+            {
+                throw std::range_error("bucket bits should be between 0 "
+                        "and 24.");
+            }
+            flat.buckets(bits, POINT_BITS);
+        }
+
+        int bucket_bits() const
+        {
+            return flat.bucket_bits();
+        }
+
+        // memory used by the bucket table.
+        std::size_t table_bytes() const
+        {
+            return flat.table_bytes();
+        }
+
+        // memory the lookup layout uses. for tree_layout this is the
+        // master ring, estimated as a value, a colour and three links per
+        // point, allocator overhead left out.
+        std::size_t lookup_bytes() const
+        {
+            switch(ring_layout)
+            {
+            case flat_layout:
+                return flat.bytes();
+            case eytzinger_layout:
+                return eytzinger.bytes();
+            case compact_layout:
+                return compact.bytes();
+            default:
+                return ring.size() * (sizeof(typename ring_type::value_type)
+                        + 4 * sizeof(void*));
+            }
+        }
+
+        double bytes_per_point() const
+        {
+            return ring.empty() ? 0 : (double)lookup_bytes() / ring.size();
+        }
+
+        // smallest point whose position on [0, 1] is not less than
+        // resource, MAX_POINT if there is none. points wider than a
+        // double mantissa are not told apart, the rounded one is used.
+        static point_type point(double resource)
+        {
+            if(resource >= 1)
+            {
+                return MAX_POINT;
+            }
+            const double scale = (double)MAX_POINT;
+            point_type p = (point_type)std::ceil(resource * scale);
+            if(POINT_BITS > 52)
+            {
+                return p;
+            }
+            while(p > 0 && (double)(p - 1) / scale >= resource)
+            {
+                --p;
+            }
+            while(p < MAX_POINT && (double)p / scale < resource)
+            {
+                ++p;
+            }
+            return p;
+        }
+
+        // ring position of a key, the top POINT_BITS of its key_hash().
+        static point_type point(uint64_t key)
+        {
+            return key_hash(key) >> (64 - POINT_BITS);
+        }
+
+        static point_type point(const void* key, std::size_t len)
+        {
+            return key_hash(key, len) >> (64 - POINT_BITS);
+        }
+
+        // the ring itself, points in increasing order with their owners.
+        const_iterator begin() const
+        {
+            return ring.begin();
+        }
+
+        const_iterator end() const
+        {
+            return ring.end();
+        }
+
+        // number of points on the ring.
+        std::size_t size() const
+        {
+            return ring.size();
+        }
+
+        const static int MAX_NODES = 0x7FFFFFFF;
+        const static int POINT_BITS = sizeof(Point) * 8 - 1;
+        const static point_type MAX_POINT =
+            ((point_type)1 << POINT_BITS) - 1;
+        const static int MAX_BUCKET_BITS = 24;
 
-            ring_type::const_iterator it = ring.lower_bound(resource);
+    protected:
+        generator_type& generator()
+        {
+            return point_generator;
+        }
+
+    private:
+        enum
+        {
+            batch_size = 256,
+            load_shards = 16
+        };
+
+        // a counter 64 bytes from its neighbours, so no two share a
+        // cache line whatever the alignment of the array.
+        struct load_line
+        {
+            long value;
+            char padding[64 - sizeof(long)];
+        };
+
+        // shard of the total the calling thread updates.
+        static std::size_t shard()
+        {
+            return key_hash((uint64_t)(uintptr_t)pthread_self())
+                % load_shards;
+        }
+
+        // position of id among the sorted ids, which indexes its load,
+        // alive_ids.size() if it is not on the ring.
+        std::size_t slot_of(const id_type& id) const
+        {
+            std::size_t slot = std::lower_bound(alive_ids.begin(),
+                    alive_ids.end(), id) - alive_ids.begin();
+            return slot == alive_ids.size() || id < alive_ids[slot]
+                ? alive_ids.size() : slot;
+        }
+
+        id_type successor(point_type p) const
+        {
+            if(ring_layout == flat_layout)
+            {
+                return flat.successor(p);
+            }
+            if(ring_layout == eytzinger_layout)
+            {
+                return eytzinger.successor(p);
+            }
+            if(ring_layout == compact_layout)
+            {
+                return compact.successor(p);
+            }
+
+            const_iterator it = ring.lower_bound(p);
             if(it == ring.end())
             {
                 it = ring.begin();
@@ -123,37 +660,348 @@ namespace algorithm
             return it->second;
         }
 
+        std::size_t successors(point_type p, std::size_t k,
+                id_type* out) const
+        {
+            k = std::min(k, nodes.size());
+            if(k == 0)
+            {
+                return 0;
+            }
+
+            std::size_t count = 0;
+            if(ring_layout == flat_layout)
+            {
+                std::size_t index = flat.lower_bound(p);
+                index = index == flat.size() ? 0 : index;
+                out[count++] = flat.owner(index);
+                while(count < k)
+                {
+                    index = flat.next_owner(index);
+                    id_type id = flat.owner(index);
+                    if(std::find(out, out + count, id) == out + count)
+                    {
+                        out[count++] = id;
+                    }
+                }
+                return count;
+            }
+
+            const_iterator it = ring.lower_bound(p);
+            while(count < k)
+            {
+                it = it == ring.end() ? ring.begin() : it;
+                if(std::find(out, out + count, it->second) == out + count)
+                {
+                    out[count++] = it->second;
+                }
+                ++it;
+            }
+            return count;
+        }
+
+        // there is always a node below the cap, as the cap is above
+        // the average load. the compact layout stores owners by their
+        // position among the sorted ids already, the others look it up.
+        id_type bounded_successor(point_type p) const
+        {
+            long cap = (long)std::ceil((1 + epsilon) * (total_load() + 1)
+                    / nodes.size());
+            if(ring_layout == compact_layout)
+            {
+                std::size_t size = compact.size();
+                std::size_t index = compact.lower_bound(p);
+                for(std::size_t step = 0; step < size; ++step, ++index)
+                {
+                    index = index == size ? 0 : index;
+                    if(__atomic_load_n(&loads[compact.slot(index)].value,
+                                __ATOMIC_RELAXED) < cap)
+                    {
+                        return compact.owner(index);
+                    }
+                }
+                return compact.owner(index == size ? 0 : index);
+            }
+            if(ring_layout == flat_layout)
+            {
+                std::size_t size = flat.size();
+                std::size_t index = flat.lower_bound(p);
+                for(std::size_t step = 0; step < size; ++step, ++index)
+                {
+                    index = index == size ? 0 : index;
+                    if(load(flat.owner(index)) < cap)
+                    {
+                        return flat.owner(index);
+                    }
+                }
+                return flat.owner(index == size ? 0 : index);
+            }
+
+            const_iterator it = ring.lower_bound(p);
+            for(std::size_t step = 0; step < ring.size(); ++step, ++it)
+            {
+                it = it == ring.end() ? ring.begin() : it;
+                if(load(it->second) < cap)
+                {
+                    return it->second;
+                }
+            }
+            return (it == ring.end() ? ring.begin() : it)->second;
+        }
+
+        typedef typename std::vector<typename batch::operation>
+            ::const_iterator operation_iterator;
+
+        // throws if joining more nodes would overflow the compact layout.
+        void reserve(std::size_t joining) const
+        {
+            if(ring_layout == compact_layout && nodes.size() + joining
+                    > compact_ring<point_type, id_type>::MAX_OWNERS)
+            {
+                throw std::range_error("compact layout holds at most "
+                        "65536 nodes.");
+            }
+        }
+
+        // the ring updates behind add(), remove() and erase(), leaving
+        // the lookup layout to rebuild().
+        void insert(const id_type& id, int w)
+        {
+            if(w <= 0)
+            {
+                return;
+            }
+            typename std::vector<id_type>::iterator alive =
+                std::lower_bound(alive_ids.begin(), alive_ids.end(), id);
+            if(alive == alive_ids.end() || id < *alive)
+            {
+                loads.insert(loads.begin() + (alive - alive_ids.begin()),
+                        load_line());
+                alive_ids.insert(alive, id);
+            }
+
+            std::vector<point_type>& points = nodes[id].points;
+            int current_weight = points.size();
+            for(int counter = 0, sequence = current_weight; counter < w;
+                    ++sequence)
+            {
+                point_type index = point_generator(id, sequence);
+                if(ring.insert(std::make_pair(index, id)).second)
+                {
+                    points.push_back(index);
+                    counter++;
+                }
+            }
+        }
+
+        int take(const id_type& id, int w)
+        {
+            typename node_map::iterator node = nodes.find(id);
+            if(node == nodes.end())
+            {
+                return 0;
+            }
+
+            std::vector<point_type>& points = node->second.points;
+            int current_weight = points.size();
+
+            w = std::min(w, current_weight);
+
+            for(int counter = 0; counter < w; ++counter)
+            {
+                ring.erase(points.back());
+                points.pop_back();
+                --current_weight;
+            }
+            if(current_weight == 0)
+            {
+                forget(id);
+                nodes.erase(node);
+            }
+            return current_weight;
+        }
+
+        bool drop(const id_type& id)
+        {
+            typename node_map::iterator node = nodes.find(id);
+            if(node == nodes.end())
+            {
+                return false;
+            }
+
+            std::vector<point_type>& points = node->second.points;
+            for(typename std::vector<point_type>::const_iterator it = points.begin(),
+                    end = points.end(); it != end; ++it)
+            {
+                ring.erase(*it);
+            }
+            forget(id);
+            nodes.erase(node);
+            return true;
+        }
+
+        // the load of id leaves the total with it. only the sum of the
+        // shards is meant, so any shard takes it.
+        void forget(const id_type& id)
+        {
+            std::size_t slot = slot_of(id);
+            totals[0].value -= loads[slot].value;
+            loads.erase(loads.begin() + slot);
+            alive_ids.erase(alive_ids.begin() + slot);
+        }
+
+        void rebuild()
+        {
+            if(ring_layout == flat_layout)
+            {
+                flat.assign(ring.begin(), ring.end());
+            }
+            else if(ring_layout == eytzinger_layout)
+            {
+                eytzinger.assign(ring.begin(), ring.end());
+            }
+            else if(ring_layout == compact_layout)
+            {
+                compact.assign(ring.begin(), ring.end());
+            }
+        }
+
+        ring_type ring;
+
+        // points of every node in insertion order. positions already
+        // taken are skipped by add(), so remove() and erase() delete
+        // the recorded keys instead of scanning the ring.
+        struct node_entry
+        {
+            std::vector<point_type> points;
+        };
+        typedef std::map<id_type, node_entry> node_map;
+        node_map nodes;
+
+        generator_type point_generator;
+
+        double epsilon;
+        load_line totals[load_shards];
+
+        // ids of nodes, sorted for alive(), and their loads.
+        std::vector<id_type> alive_ids;
+        std::vector<load_line> loads;
+
+        layout_type ring_layout;
+        flat_ring<point_type, id_type> flat;
+        eytzinger_ring<point_type, id_type> eytzinger;
+        compact_ring<point_type, id_type> compact;
+    };
+
+    class const_hash;
+
+    // forwards to const_hash::random(), so classes derived from
+    // const_hash still decide where points go.
+    class const_hash_generator
+    {
+    public:
+        const_hash_generator():
+            owner(NULL)
+        {
+        }
+
+        uint32_t operator()(int x, int y) const;
+
+    private:
+        friend class const_hash;
+
+        const_hash* owner;
+    };
+
+    // the classic interface: 32-bit points, int ids and virtual members
+    // that derived classes may override. code that wants inlined
+    // lookups and point generation uses basic_const_hash<> directly.
+    class const_hash : public basic_const_hash<uint32_t, int,
+        const_hash_generator>
+    {
+    public:
+        typedef basic_const_hash<uint32_t, int, const_hash_generator>
+            base_type;
+
+        explicit const_hash(layout_type layout = tree_layout):
+            base_type(layout)
+        {
+            bind();
+        }
+
+        const_hash(const const_hash& other):
+            base_type(other)
+        {
+            bind();
+        }
+
+        const_hash& operator=(const const_hash& other)
+        {
+            base_type::operator=(other);
+            bind();
+            return *this;
+        }
+
+        virtual ~const_hash(){}
+
+        virtual void add(int id, int w)
+        {
+            base_type::add(id, w);
+        }
+
+        virtual int remove(int id, int w)
+        {
+            return base_type::remove(id, w);
+        }
+
+        virtual void erase(int id)
+        {
+            base_type::erase(id);
+        }
+
+        virtual void apply(const batch& changes)
+        {
+            base_type::apply(changes);
+        }
+
+        virtual int weight(int id) const
+        {
+            return base_type::weight(id);
+        }
+
+        virtual int hash(double resource) const
+        {
+            return base_type::hash(resource);
+        }
+
         virtual bool empty() const
         {
-            return ring.empty();
+            return base_type::empty();
         }
 
         virtual std::set<int> alive_set() const
         {
-            return id_set;
+            return base_type::alive_set();
         }
 
-        const static int MAX_NODES = 0x7FFFFFFF;
-
     protected:
-        virtual double random(int x, int y)
-        {
-            unsigned int a = x * 123456789 + y;
-            a -= (a<<6);
-            a ^= (a>>17);
-            a -= (a<<9);
-            a ^= (a<<4);
-            a -= (a<<3);
-            a ^= (a<<10);
-            a ^= (a>>15);
-            double r = a % MAX_NODES;
-            return r/MAX_NODES;
+        virtual point_type random(int x, int y)
+        {
+            return ring_point(x, y);
         }
+
     private:
-        typedef std::map<double ,int> ring_type;
-        ring_type ring;
+        friend class const_hash_generator;
 
-        std::set<int> id_set;
+        void bind()
+        {
+            generator().owner = this;
+        }
     };
+
+    inline uint32_t const_hash_generator::operator()(int x, int y) const
+    {
+        return owner->random(x, y);
+    }
 }
 #endif //__CONST_HASH_H__
@@ -0,0 +1,498 @@
+#ifndef __FLAT_RING_H__
+#define __FLAT_RING_H__
+#include <stdexcept>
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+#include <stdint.h>
+#include "algorithm/ringsearch.hpp"
+namespace algorithm
+{
+    // Immutable lookup image of a ring: points and owners kept in two
+    // contiguous sorted arrays, so a search only touches the points.
+    template<typename Point, typename Owner = int>
+    class flat_ring
+    {
+    public:
+        typedef Point point_type;
+        typedef Owner owner_type;
+        typedef std::size_t size_type;
+
+        flat_ring():
+            table_bits(0),
+            range_bits(0),
+            shift(0)
+        {
+        }
+
+        template<typename InputIterator>
+        void assign(InputIterator begin, InputIterator end)
+        {
+            points.clear();
+            owners.clear();
+            for(; begin != end; ++begin)
+            {
+                points.push_back(begin->first);
+                owners.push_back(begin->second);
+            }
+            index();
+            link();
+        }
+
+        void clear()
+        {
+            points.clear();
+            owners.clear();
+            index();
+            link();
+        }
+
+        size_type size() const
+        {
+            return points.size();
+        }
+
+        bool empty() const
+        {
+            return points.empty();
+        }
+
+        // splits [0, 2^point_bits) into 2^bits equal buckets and records
+        // the first point index of each, so a lookup only searches the
+        // points of its own bucket. 0 bits drops the table.
+        void buckets(int bits, int point_bits)
+        {
+            table_bits = bits;
+            range_bits = point_bits;
+            index();
+        }
+
+        int bucket_bits() const
+        {
+            return table_bits;
+        }
+
+        size_type table_bytes() const
+        {
+            return table.size() * sizeof(uint32_t);
+        }
+
+        // memory of the whole image, bucket table and links included.
+        size_type bytes() const
+        {
+            return points.size() * sizeof(point_type)
+                + owners.size() * sizeof(owner_type)
+                + next.size() * sizeof(uint32_t) + table_bytes();
+        }
+
+        // index of the first point not less than p, size() if none.
+        size_type lower_bound(point_type p) const
+        {
+            if(points.empty())
+            {
+                return 0;
+            }
+            if(table.empty())
+            {
+                return search(&points[0], points.size(), p);
+            }
+
+            size_type bucket = (size_type)(p >> shift);
+            if(bucket >= table.size() - 1)
+            {
+                return points.size();
+            }
+            size_type low = table[bucket], high = table[bucket + 1];
+            return low + search(&points[0] + low, high - low, p);
+        }
+
+        point_type point(size_type index) const
+        {
+            return points[index];
+        }
+
+        owner_type owner(size_type index) const
+        {
+            return owners[index];
+        }
+
+        // index of the next point clockwise whose owner differs from the
+        // owner of index, index itself if the ring has a single owner.
+        size_type next_owner(size_type index) const
+        {
+            return next[index];
+        }
+
+        // owner of the first point clockwise from p, wrapping to the
+        // beginning of the ring. the ring must not be empty.
+        owner_type successor(point_type p) const
+        {
+            size_type index = lower_bound(p);
+            if(index == points.size())
+            {
+                index = 0;
+            }
+            return owners[index];
+        }
+
+        // successor() of n points at once. the searches of a group run
+        // in lockstep, so their cache misses overlap, and both possible
+        // probes of the next level are prefetched.
+        void successors(const point_type* p, size_type n,
+                owner_type* out) const
+        {
+            if(!table.empty())
+            {
+                for(size_type i = 0; i < n; ++i)
+                {
+                    out[i] = successor(p[i]);
+                }
+                return;
+            }
+
+            const size_type size = points.size();
+            const point_type* first = &points[0];
+            const point_type* base[group_size];
+            for(size_type start = 0; start < n; start += group_size)
+            {
+                const size_type m = std::min(n - start,
+                        (size_type)group_size);
+                const point_type* key = p + start;
+                for(size_type j = 0; j < m; ++j)
+                {
+                    base[j] = first;
+                }
+                for(size_type len = size; len > 1;)
+                {
+                    const size_type half = len / 2;
+                    const size_type next = (len - half) / 2;
+                    for(size_type j = 0; j < m; ++j)
+                    {
+                        __builtin_prefetch(base[j] + next);
+                        __builtin_prefetch(base[j] + half + next);
+                        base[j] = (base[j][half] < key[j]) ?
+                            base[j] + half : base[j];
+                    }
+                    len -= half;
+                }
+                for(size_type j = 0; j < m; ++j)
+                {
+                    size_type index = (base[j] - first) + (*base[j] < key[j]);
+                    out[start + j] = owners[index == size ? 0 : index];
+                }
+            }
+        }
+
+        // lower bound within any sorted [first, first + size). the last
+        // levels are resolved by counting a whole window of points with
+        // ring_search::count_less().
+        static size_type search(const point_type* first, size_type size,
+                point_type p)
+        {
+            if(size == 0)
+            {
+                return 0;
+            }
+            const point_type* base = first;
+            size_type n = size;
+            if(size >= (size_type)ring_search::window)
+            {
+                while(n > (size_type)ring_search::window)
+                {
+                    size_type half = n / 2;
+                    base = (base[half] < p) ? base + half : base;
+                    n -= half;
+                }
+                base = std::min(base, first + size - ring_search::window);
+                return (base - first) + ring_search::count_less(base, p);
+            }
+            while(n > 1)
+            {
+                size_type half = n / 2;
+                base = (base[half] < p) ? base + half : base;
+                n -= half;
+            }
+            return (base - first) + (*base < p);
+        }
+
+    private:
+        enum
+        {
+            group_size = 16
+        };
+
+        void index()
+        {
+            table.clear();
+            if(table_bits <= 0)
+            {
+                return;
+            }
+
+            size_type count = (size_type)1 << table_bits;
+            shift = range_bits - table_bits;
+            table.resize(count + 1);
+            size_type i = 0;
+            for(size_type bucket = 0; bucket < count; ++bucket)
+            {
+                point_type start = (point_type)bucket << shift;
+                while(i < points.size() && points[i] < start)
+                {
+                    ++i;
+                }
+                table[bucket] = i;
+            }
+            table[count] = points.size();
+        }
+
+        // two passes backwards around the ring, the first one settles
+        // the links that wrap past the end.
+        void link()
+        {
+            const size_type size = points.size();
+            next.assign(size, 0);
+            if(size == 0)
+            {
+                return;
+            }
+            if(std::count(owners.begin(), owners.end(), owners[0])
+                    == (std::ptrdiff_t)size)
+            {
+                for(size_type i = 0; i < size; ++i)
+                {
+                    next[i] = i;
+                }
+                return;
+            }
+            for(size_type j = 2 * size; j-- > 0;)
+            {
+                size_type i = j % size;
+                size_type after = (i + 1) % size;
+                next[i] = owners[after] != owners[i] ? after : next[after];
+            }
+        }
+
+        std::vector<point_type> points;
+        std::vector<owner_type> owners;
+        std::vector<uint32_t> next;
+
+        std::vector<uint32_t> table;
+        int table_bits;
+        int range_bits;
+        int shift;
+    };
+
+    // the same image stored in bfs (eytzinger) order: the children of
+    // slot k are 2k and 2k+1, so the next levels of a search share cache
+    // lines and can be prefetched before they are needed.
+    template<typename Point, typename Owner = int>
+    class eytzinger_ring
+    {
+    public:
+        typedef Point point_type;
+        typedef Owner owner_type;
+        typedef std::size_t size_type;
+
+        eytzinger_ring(){}
+
+        template<typename InputIterator>
+        void assign(InputIterator begin, InputIterator end)
+        {
+            std::vector<point_type> sorted_points;
+            std::vector<owner_type> sorted_owners;
+            for(; begin != end; ++begin)
+            {
+                sorted_points.push_back(begin->first);
+                sorted_owners.push_back(begin->second);
+            }
+            points.assign(sorted_points.size() + 1, point_type());
+            owners.assign(sorted_owners.size() + 1, owner_type());
+            if(!sorted_points.empty())
+            {
+                build(sorted_points, sorted_owners, 0, 1);
+            }
+        }
+
+        void clear()
+        {
+            points.clear();
+            owners.clear();
+        }
+
+        size_type size() const
+        {
+            return points.empty() ? 0 : points.size() - 1;
+        }
+
+        bool empty() const
+        {
+            return size() == 0;
+        }
+
+        size_type bytes() const
+        {
+            return points.size() * sizeof(point_type)
+                + owners.size() * sizeof(owner_type);
+        }
+
+        // owner of the first point clockwise from p, wrapping to the
+        // smallest point. the ring must not be empty.
+        owner_type successor(point_type p) const
+        {
+            const point_type* base = &points[0];
+            const size_type n = size();
+            size_type k = 1;
+            while(k <= n)
+            {
+                __builtin_prefetch(base + k * prefetch_stride);
+                k = 2 * k + (base[k] < p);
+            }
+            k >>= __builtin_ffsl(~k);
+            return k == 0 ? owners[first] : owners[k];
+        }
+
+    private:
+        enum
+        {
+            // slots four levels down, one cache line for 32-bit points.
+            prefetch_stride = 64 / sizeof(Point) > 0 ? 64 / sizeof(Point) : 1
+        };
+
+        size_type build(const std::vector<point_type>& sorted_points,
+                const std::vector<owner_type>& sorted_owners,
+                size_type i, size_type k)
+        {
+            if(k <= sorted_points.size())
+            {
+                i = build(sorted_points, sorted_owners, i, 2 * k);
+                if(i == 0)
+                {
+                    first = k;
+                }
+                points[k] = sorted_points[i];
+                owners[k] = sorted_owners[i];
+                ++i;
+                i = build(sorted_points, sorted_owners, i, 2 * k + 1);
+            }
+            return i;
+        }
+
+        std::vector<point_type> points;
+        std::vector<owner_type> owners;
+        size_type first;
+    };
+
+    // the flat image with owners stored as 16-bit indices into a side
+    // table of distinct ids, six bytes a point for 32-bit points. holds
+    // at most MAX_OWNERS distinct owners.
+    template<typename Point, typename Owner = int>
+    class compact_ring
+    {
+    public:
+        typedef Point point_type;
+        typedef Owner owner_type;
+        typedef std::size_t size_type;
+
+        compact_ring(){}
+
+        template<typename InputIterator>
+        void assign(InputIterator begin, InputIterator end)
+        {
+            std::vector<point_type> new_points;
+            std::vector<owner_type> owners;
+            for(; begin != end; ++begin)
+            {
+                new_points.push_back(begin->first);
+                owners.push_back(begin->second);
+            }
+            std::vector<owner_type> new_ids(owners);
+            std::sort(new_ids.begin(), new_ids.end());
+            new_ids.erase(std::unique(new_ids.begin(), new_ids.end()),
+                    new_ids.end());
+            if(new_ids.size() > (size_type)MAX_OWNERS)
+            {
+                throw std::range_error("compact ring holds at most 65536 "
+                        "owners.");
+            }
+
+            std::vector<uint16_t> new_slots(owners.size());
+            for(size_type i = 0; i < owners.size(); ++i)
+            {
+                new_slots[i] = (uint16_t)(std::lower_bound(new_ids.begin(),
+                            new_ids.end(), owners[i]) - new_ids.begin());
+            }
+            points.swap(new_points);
+            slots.swap(new_slots);
+            ids.swap(new_ids);
+        }
+
+        void clear()
+        {
+            points.clear();
+            slots.clear();
+            ids.clear();
+        }
+
+        size_type size() const
+        {
+            return points.size();
+        }
+
+        bool empty() const
+        {
+            return points.empty();
+        }
+
+        // index of the first point not less than p, size() if none.
+        size_type lower_bound(point_type p) const
+        {
+            if(points.empty())
+            {
+                return 0;
+            }
+            return flat_ring<point_type, owner_type>::search(&points[0],
+                    points.size(), p);
+        }
+
+        point_type point(size_type index) const
+        {
+            return points[index];
+        }
+
+        owner_type owner(size_type index) const
+        {
+            return ids[slots[index]];
+        }
+
+        // position of the owner of the point at index among the sorted,
+        // distinct owners.
+        size_type slot(size_type index) const
+        {
+            return slots[index];
+        }
+
+        // owner of the first point clockwise from p, wrapping to the
+        // beginning of the ring. the ring must not be empty.
+        owner_type successor(point_type p) const
+        {
+            size_type index = lower_bound(p);
+            return owner(index == points.size() ? 0 : index);
+        }
+
+        // points, indices and the side table together.
+        size_type bytes() const
+        {
+            return points.size() * sizeof(point_type)
+                + slots.size() * sizeof(uint16_t)
+                + ids.size() * sizeof(owner_type);
+        }
+
+        const static size_type MAX_OWNERS = 65536;
+
+    private:
+        std::vector<point_type> points;
+        std::vector<uint16_t> slots;
+        std::vector<owner_type> ids;
+    };
+}
+#endif //__FLAT_RING_H__
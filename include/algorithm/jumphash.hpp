@@ -0,0 +1,111 @@
+#ifndef __JUMP_HASH_H__
+#define __JUMP_HASH_H__
+#include <stdexcept>
+#include <cstddef>
+#include <set>
+#include <vector>
+#include <stdint.h>
+#include "algorithm/keyhash.hpp"
+namespace algorithm
+{
+    // lamping-veach jump consistent hash. buckets are numbered in the
+    // order nodes were appended, and only the last one can be dropped,
+    // so there is no ring to store or search.
+    class jump_hash
+    {
+    public:
+        jump_hash(){}
+        virtual ~jump_hash(){}
+
+        virtual void push_back(int id)
+        {
+            if(id_set.count(id))
+            {
+                throw std::invalid_argument("node already exists.");
+            }
+            if(ids.size() >= (std::size_t)MAX_NODES)
+            {
+                throw std::range_error("too many nodes");
+            }
+            ids.push_back(id);
+            id_set.insert(id);
+        }
+
+        virtual int pop_back()
+        {
+            if(empty())
+            {
+                throw std::domain_error("empty ring.");
+            }
+            int id = ids.back();
+            ids.pop_back();
+            id_set.erase(id);
+            return id;
+        }
+
+        virtual int hash(double resource) const
+        {
+            if(resource < 0 || resource > 1)
+            {
+                throw std::range_error("resource should be between 0"
+                        "and 1.");
+            }
+            return hash_key((uint64_t)(resource * 9007199254740992.0));
+        }
+
+        int hash_key(uint64_t key) const
+        {
+            if(empty())
+            {
+                throw std::domain_error("empty ring.");
+            }
+            return ids[bucket(key_hash(key), ids.size())];
+        }
+
+        int hash_key(const void* key, std::size_t len) const
+        {
+            if(empty())
+            {
+                throw std::domain_error("empty ring.");
+            }
+            return ids[bucket(key_hash(key, len), ids.size())];
+        }
+
+        virtual bool empty() const
+        {
+            return ids.empty();
+        }
+
+        virtual std::set<int> alive_set() const
+        {
+            return id_set;
+        }
+
+        std::size_t size() const
+        {
+            return ids.size();
+        }
+
+        // bucket of key among buckets, 0 if there are none.
+        static std::size_t bucket(uint64_t key, std::size_t buckets)
+        {
+            int64_t b = -1, j = 0;
+            while(j < (int64_t)buckets)
+            {
+                b = j;
+                key = key * 2862933555777941757ull + 1;
+                j = (int64_t)((b + 1) * ((double)(1ll << 31)
+                            / (double)((key >> 33) + 1)));
+            }
+            return b < 0 ? 0 : (std::size_t)b;
+        }
+
+        const static int MAX_NODES = 0x7FFFFFFF;
+
+    private:
+        std::vector<int> ids;
+
+        std::set<int> id_set;
+    };
+}
+#endif //__JUMP_HASH_H__
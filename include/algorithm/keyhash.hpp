@@ -0,0 +1,139 @@
+#ifndef __KEY_HASH_H__
+#define __KEY_HASH_H__
+#include <cstddef>
+#include <cstring>
+#include <stdint.h>
+namespace algorithm
+{
+    // wyhash (final version 4) mixers used to turn caller keys into ring
+    // positions. they are not meant to resist hash flooding.
+    namespace key_hash_detail
+    {
+        const uint64_t secret0 = 0x2d358dccaa6c78a5ull;
+        const uint64_t secret1 = 0x8bb84b93962eacc9ull;
+        const uint64_t secret2 = 0x4b33a62ed433d4a3ull;
+        const uint64_t secret3 = 0x4d5a2da51de1aa47ull;
+
+        inline void mum(uint64_t& a, uint64_t& b)
+        {
+#ifdef __SIZEOF_INT128__
+            unsigned __int128 r = a;
+            r *= b;
+            a = (uint64_t)r;
+            b = (uint64_t)(r >> 64);
+#else
+            uint64_t ha = a >> 32, hb = b >> 32;
+            uint64_t la = (uint32_t)a, lb = (uint32_t)b;
+            uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+            uint64_t t = rl + (rm0 << 32);
+            uint64_t c = t < rl;
+            uint64_t lo = t + (rm1 << 32);
+            c += lo < t;
+            uint64_t hi = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+            a = lo;
+            b = hi;
+#endif
+        }
+
+        inline uint64_t mix(uint64_t a, uint64_t b)
+        {
+            mum(a, b);
+            return a ^ b;
+        }
+
+        inline uint64_t read64(const unsigned char* p)
+        {
+            uint64_t v;
+            std::memcpy(&v, p, sizeof(v));
+            return v;
+        }
+
+        inline uint64_t read32(const unsigned char* p)
+        {
+            uint32_t v;
+            std::memcpy(&v, p, sizeof(v));
+            return v;
+        }
+
+        inline uint64_t read3(const unsigned char* p, std::size_t k)
+        {
+            return (((uint64_t)p[0]) << 16) | (((uint64_t)p[k >> 1]) << 8)
+                | p[k - 1];
+        }
+    }
+
+    // every ring takes two kinds of lookup. hash(double) places a
+    // resource given as a position on [0, 1], as const_hash always did.
+    // hash_key() places a caller key, a 64-bit integer or a byte string,
+    // mixed by key_hash() first. the key path has its own name so that
+    // integral keys of any type convert to uint64_t instead of being
+    // ambiguous with, or silently taken as, a position.
+    inline uint64_t key_hash(uint64_t key, uint64_t seed = 0)
+    {
+        using namespace key_hash_detail;
+        uint64_t a = key ^ secret0;
+        uint64_t b = seed ^ secret1;
+        mum(a, b);
+        return mix(a ^ secret0, b ^ secret1);
+    }
+
+    inline uint64_t key_hash(const void* key, std::size_t len,
+            uint64_t seed = 0)
+    {
+        using namespace key_hash_detail;
+        const unsigned char* p = static_cast<const unsigned char*>(key);
+        seed ^= mix(seed ^ secret0, secret1);
+        uint64_t a, b;
+        if(len <= 16)
+        {
+            if(len >= 4)
+            {
+                a = (read32(p) << 32) | read32(p + ((len >> 3) << 2));
+                b = (read32(p + len - 4) << 32)
+                    | read32(p + len - 4 - ((len >> 3) << 2));
+            }
+            else if(len > 0)
+            {
+                a = read3(p, len);
+                b = 0;
+            }
+            else
+            {
+                a = b = 0;
+            }
+        }
+        else
+        {
+            std::size_t i = len;
+            if(i > 48)
+            {
+                uint64_t see1 = seed, see2 = seed;
+                do
+                {
+                    seed = mix(read64(p) ^ secret1, read64(p + 8) ^ seed);
+                    see1 = mix(read64(p + 16) ^ secret2,
+                            read64(p + 24) ^ see1);
+                    see2 = mix(read64(p + 32) ^ secret3,
+                            read64(p + 40) ^ see2);
+                    p += 48;
+                    i -= 48;
+                }
+                while(i > 48);
+                seed ^= see1 ^ see2;
+            }
+            while(i > 16)
+            {
+                seed = mix(read64(p) ^ secret1, read64(p + 8) ^ seed);
+                i -= 16;
+                p += 16;
+            }
+            a = read64(p + i - 16);
+            b = read64(p + i - 8);
+        }
+        a ^= secret1;
+        b ^= seed;
+        mum(a, b);
+        return mix(a ^ secret0 ^ len, b ^ secret1);
+    }
+}
+#endif //__KEY_HASH_H__
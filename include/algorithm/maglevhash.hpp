@@ -0,0 +1,219 @@
+#ifndef __MAGLEV_HASH_H__
+#define __MAGLEV_HASH_H__
+#include <stdexcept>
+#include <algorithm>
+#include <cstddef>
+#include <map>
+#include <set>
+#include <vector>
+#include <stdint.h>
+#include "algorithm/keyhash.hpp"
+namespace algorithm
+{
+    // maglev hashing: every node walks its own permutation of a prime
+    // sized table, taking free slots in turn until the table is full. a
+    // lookup is one modulo and one table read.
+    class maglev_hash
+    {
+    public:
+        explicit maglev_hash(std::size_t size = DEFAULT_TABLE_SIZE):
+            table_size(size)
+        {
+            if(!prime(size))
+            {
+                throw std::invalid_argument("table size should be prime.");
+            }
+        }
+
+        virtual ~maglev_hash(){}
+
+        // weights are relative: a node of weight 2 takes twice the slots
+        // of a node of weight 1.
+        virtual void add(int id, int w)
+        {
+            if(w <= 0)
+            {
+                return;
+            }
+            node_type::iterator node = nodes.find(id);
+            if(node == nodes.end())
+            {
+                node = nodes.insert(std::make_pair(id,
+                            permutation(id, table_size))).first;
+            }
+            node->second.weight += w;
+            populate();
+        }
+
+        virtual void erase(int id)
+        {
+            if(nodes.erase(id))
+            {
+                populate();
+            }
+        }
+
+        virtual int weight(int id) const
+        {
+            node_type::const_iterator node = nodes.find(id);
+            if(node == nodes.end())
+            {
+                return 0;
+            }
+            return node->second.weight;
+        }
+
+        virtual int hash(double resource) const
+        {
+            if(resource < 0 || resource > 1)
+            {
+                throw std::range_error("resource should be between 0"
+                        "and 1.");
+            }
+            return hash_key((uint64_t)(resource * 9007199254740992.0));
+        }
+
+        int hash_key(uint64_t key) const
+        {
+            if(empty())
+            {
+                throw std::domain_error("empty ring.");
+            }
+            return table[key_hash(key) % table_size];
+        }
+
+        int hash_key(const void* key, std::size_t len) const
+        {
+            if(empty())
+            {
+                throw std::domain_error("empty ring.");
+            }
+            return table[key_hash(key, len) % table_size];
+        }
+
+        virtual bool empty() const
+        {
+            return nodes.empty();
+        }
+
+        virtual std::set<int> alive_set() const
+        {
+            std::set<int> ids;
+            for(node_type::const_iterator it = nodes.begin();
+                    it != nodes.end(); ++it)
+            {
+                ids.insert(ids.end(), it->first);
+            }
+            return ids;
+        }
+
+        std::size_t size() const
+        {
+            return table_size;
+        }
+
+        std::size_t table_bytes() const
+        {
+            return table.size() * sizeof(int);
+        }
+
+        const static std::size_t DEFAULT_TABLE_SIZE = 65537;
+
+    private:
+        // offset and skip of a node's permutation, hashed once when the
+        // node joins and reused by every rebuild.
+        struct permutation
+        {
+            permutation(int id, std::size_t size):
+                offset(key_hash((uint64_t)id, 1) % size),
+                skip(key_hash((uint64_t)id, 2) % (size - 1) + 1),
+                weight(0)
+            {
+            }
+
+            uint64_t offset;
+            uint64_t skip;
+            int weight;
+        };
+
+        static bool prime(std::size_t n)
+        {
+            if(n < 3)
+            {
+                return n == 2;
+            }
+            if(n % 2 == 0)
+            {
+                return false;
+            }
+            for(std::size_t i = 3; i * i <= n; i += 2)
+            {
+                if(n % i == 0)
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        // fills the table from scratch in node id order, so the result
+        // only depends on the current nodes. each round hands a node
+        // weight / max_weight turns.
+        void populate()
+        {
+            table.clear();
+            if(nodes.empty())
+            {
+                return;
+            }
+
+            std::vector<const permutation*> order;
+            std::vector<int> ids;
+            int max_weight = 0;
+            for(node_type::const_iterator it = nodes.begin();
+                    it != nodes.end(); ++it)
+            {
+                order.push_back(&it->second);
+                ids.push_back(it->first);
+                max_weight = std::max(max_weight, it->second.weight);
+            }
+
+            std::vector<uint64_t> next(order.size(), 0);
+            std::vector<double> credit(order.size(), 0);
+            std::vector<bool> taken(table_size, false);
+            table.assign(table_size, 0);
+            std::size_t filled = 0;
+            while(filled < table_size)
+            {
+                for(std::size_t i = 0; i < order.size()
+                        && filled < table_size; ++i)
+                {
+                    credit[i] += (double)order[i]->weight / max_weight;
+                    while(credit[i] >= 1 && filled < table_size)
+                    {
+                        credit[i] -= 1;
+                        uint64_t slot;
+                        do
+                        {
+                            slot = (order[i]->offset
+                                    + next[i] * order[i]->skip) % table_size;
+                            ++next[i];
+                        }
+                        while(taken[slot]);
+                        taken[slot] = true;
+                        table[slot] = ids[i];
+                        ++filled;
+                    }
+                }
+            }
+        }
+
+        std::size_t table_size;
+
+        typedef std::map<int, permutation> node_type;
+        node_type nodes;
+
+        std::vector<int> table;
+    };
+}
+#endif //__MAGLEV_HASH_H__
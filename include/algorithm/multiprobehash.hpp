@@ -0,0 +1,143 @@
+#ifndef __MULTI_PROBE_HASH_H__
+#define __MULTI_PROBE_HASH_H__
+#include <stdexcept>
+#include <algorithm>
+#include <cstddef>
+#include <map>
+#include <set>
+#include <stdint.h>
+#include "algorithm/flatring.hpp"
+#include "algorithm/keyhash.hpp"
+namespace algorithm
+{
+    // multi-probe consistent hashing: one ring point per node, and every
+    // key is hashed probes times. the key goes to the node whose point
+    // follows one of its probes most closely.
+    class multiprobe_hash
+    {
+    public:
+        explicit multiprobe_hash(int probes = DEFAULT_PROBES):
+            probe_count(0)
+        {
+            this->probes(probes);
+        }
+
+        virtual ~multiprobe_hash(){}
+
+        virtual void add(int id)
+        {
+            if(nodes.count(id))
+            {
+                return;
+            }
+            uint64_t point = key_hash((uint64_t)id);
+            for(uint64_t seed = 1; ring.count(point); ++seed)
+            {
+                point = key_hash((uint64_t)id, seed);
+            }
+            ring.insert(std::make_pair(point, id));
+            nodes.insert(std::make_pair(id, point));
+            flat.assign(ring.begin(), ring.end());
+        }
+
+        virtual void erase(int id)
+        {
+            std::map<int, uint64_t>::iterator node = nodes.find(id);
+            if(node == nodes.end())
+            {
+                return;
+            }
+            ring.erase(node->second);
+            nodes.erase(node);
+            flat.assign(ring.begin(), ring.end());
+        }
+
+        void probes(int count)
+        {
+            if(count < 1 || count > MAX_PROBES)
+            {
+                throw std::range_error("probes should be between 1 "
+                        "and 256.");
+            }
+            probe_count = count;
+        }
+
+        int probes() const
+        {
+            return probe_count;
+        }
+
+        virtual int hash(double resource) const
+        {
+            if(resource < 0 || resource > 1)
+            {
+                throw std::range_error("resource should be between 0"
+                        "and 1.");
+            }
+            return hash_key((uint64_t)(resource * 9007199254740992.0));
+        }
+
+        int hash_key(uint64_t key) const
+        {
+            if(empty())
+            {
+                throw std::domain_error("empty ring.");
+            }
+
+            // probes come from double hashing, h1 + i * h2.
+            const std::size_t size = flat.size();
+            const uint64_t step = key_hash(key, 1) | 1;
+            uint64_t probe = key_hash(key);
+            uint64_t best_distance = ~(uint64_t)0;
+            std::size_t best = 0;
+            for(int i = 0; i < probe_count; ++i, probe += step)
+            {
+                std::size_t index = flat.lower_bound(probe);
+                index = index == size ? 0 : index;
+                // unsigned wrap-around gives the clockwise distance.
+                uint64_t distance = flat.point(index) - probe;
+                best = distance < best_distance ? index : best;
+                best_distance = std::min(distance, best_distance);
+            }
+            return flat.owner(best);
+        }
+
+        int hash_key(const void* key, std::size_t len) const
+        {
+            return hash_key(key_hash(key, len));
+        }
+
+        virtual bool empty() const
+        {
+            return ring.empty();
+        }
+
+        virtual std::set<int> alive_set() const
+        {
+            std::set<int> ids;
+            for(std::map<int, uint64_t>::const_iterator it = nodes.begin();
+                    it != nodes.end(); ++it)
+            {
+                ids.insert(ids.end(), it->first);
+            }
+            return ids;
+        }
+
+        std::size_t size() const
+        {
+            return ring.size();
+        }
+
+        const static int DEFAULT_PROBES = 21;
+        const static int MAX_PROBES = 256;
+
+    private:
+        int probe_count;
+
+        std::map<uint64_t, int> ring;
+        std::map<int, uint64_t> nodes;
+
+        flat_ring<uint64_t> flat;
+    };
+}
+#endif //__MULTI_PROBE_HASH_H__
@@ -0,0 +1,307 @@
+#ifndef __NODE_REGISTRY_H__
+#define __NODE_REGISTRY_H__
+#include <stdexcept>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include "algorithm/consthash.hpp"
+#include "algorithm/keyhash.hpp"
+namespace algorithm
+{
+    // interns node descriptors, address strings or user structs, into
+    // dense indices. indices of released descriptors are reused. a
+    // descriptor stays at the same address until it is released.
+    template<typename Descriptor, typename Less = std::less<Descriptor> >
+    class node_registry
+    {
+    public:
+        typedef Descriptor descriptor_type;
+
+        node_registry():
+            live(0)
+        {
+        }
+
+        // index of descriptor, interning it first if needed.
+        int intern(const descriptor_type& descriptor)
+        {
+            typename index_map::iterator it = indices.find(descriptor);
+            if(it != indices.end())
+            {
+                return it->second;
+            }
+            int index;
+            if(free.empty())
+            {
+                index = (int)descriptors.size();
+                descriptors.push_back(descriptor);
+            }
+            else
+            {
+                index = free.back();
+                free.pop_back();
+                descriptors[index] = descriptor;
+            }
+            indices.insert(std::make_pair(descriptor, index));
+            ++live;
+            return index;
+        }
+
+        // index of descriptor, -1 if it is not interned.
+        int find(const descriptor_type& descriptor) const
+        {
+            typename index_map::const_iterator it = indices.find(descriptor);
+            return it == indices.end() ? -1 : it->second;
+        }
+
+        void release(int index)
+        {
+            if(index < 0 || index >= (int)descriptors.size()
+                    || !indices.erase(descriptors[index]))
+            {
+                return;
+            }
+            descriptors[index] = descriptor_type();
+            free.push_back(index);
+            --live;
+        }
+
+        const descriptor_type& operator[](int index) const
+        {
+            return descriptors[index];
+        }
+
+        // descriptors interned now.
+        std::size_t size() const
+        {
+            return live;
+        }
+
+        bool empty() const
+        {
+            return live == 0;
+        }
+
+    private:
+        typedef std::map<descriptor_type, int, Less> index_map;
+        index_map indices;
+
+        // a deque, so interning never moves the descriptors already
+        // handed out by reference.
+        std::deque<descriptor_type> descriptors;
+        std::vector<int> free;
+        std::size_t live;
+    };
+
+    // 64-bit hash of a descriptor, deciding where its points go. works
+    // for integral descriptors and strings, other types need their own.
+    template<typename Descriptor>
+    struct descriptor_hash
+    {
+        uint64_t operator()(const Descriptor& descriptor) const
+        {
+            return key_hash((uint64_t)descriptor);
+        }
+    };
+
+    template<>
+    struct descriptor_hash<std::string>
+    {
+        uint64_t operator()(const std::string& descriptor) const
+        {
+            return key_hash(descriptor.data(), descriptor.size());
+        }
+    };
+
+    // points of a node from the hash of its descriptor, so placement does
+    // not depend on the order descriptors were interned in.
+    class seeded_generator
+    {
+    public:
+        explicit seeded_generator(const std::vector<uint64_t>* s = NULL):
+            seeds(s)
+        {
+        }
+
+        uint32_t operator()(int index, int sequence) const
+        {
+            return (uint32_t)(key_hash((*seeds)[index],
+                        (uint64_t)sequence + 1) % 0x7FFFFFFF);
+        }
+
+    private:
+        const std::vector<uint64_t>* seeds;
+    };
+
+    // a const_hash over node descriptors. the ring stores dense indices,
+    // so a lookup is one ring search and one vector read, and returns
+    // the interned descriptor itself.
+    template<typename Descriptor,
+        typename DescriptorHash = descriptor_hash<Descriptor>,
+        typename Less = std::less<Descriptor> >
+    class registry_hash
+    {
+    public:
+        typedef Descriptor descriptor_type;
+        typedef basic_const_hash<uint32_t, int, seeded_generator> ring_type;
+        typedef typename ring_type::layout_type layout_type;
+
+        explicit registry_hash(layout_type layout = ring_type::tree_layout):
+            ring(layout, seeded_generator(&seeds))
+        {
+        }
+
+        virtual ~registry_hash(){}
+
+        virtual void add(const descriptor_type& node, int w)
+        {
+            if(w <= 0)
+            {
+                return;
+            }
+            int index = nodes.intern(node);
+            if(index >= (int)seeds.size())
+            {
+                seeds.resize(index + 1);
+            }
+            if(ring.weight(index) == 0)
+            {
+                seeds[index] = hasher(node);
+            }
+            try
+            {
+                ring.add(index, w);
+            }
+            catch(...)
+            {
+                if(ring.weight(index) == 0)
+                {
+                    nodes.release(index);
+                }
+                throw;
+            }
+        }
+
+        virtual int remove(const descriptor_type& node, int w)
+        {
+            int index = nodes.find(node);
+            if(index < 0)
+            {
+                return 0;
+            }
+            int weight = ring.remove(index, w);
+            if(weight == 0)
+            {
+                nodes.release(index);
+            }
+            return weight;
+        }
+
+        virtual void erase(const descriptor_type& node)
+        {
+            int index = nodes.find(node);
+            if(index < 0)
+            {
+                return;
+            }
+            ring.erase(index);
+            nodes.release(index);
+        }
+
+        virtual int weight(const descriptor_type& node) const
+        {
+            int index = nodes.find(node);
+            return index < 0 ? 0 : ring.weight(index);
+        }
+
+        // the references returned point into the registry. they stay
+        // valid while other nodes are added or removed, until the node
+        // itself leaves the ring.
+        const descriptor_type& hash(double resource) const
+        {
+            return nodes[ring.hash(resource)];
+        }
+
+        const descriptor_type& hash_key(uint64_t key) const
+        {
+            return nodes[ring.hash_key(key)];
+        }
+
+        const descriptor_type& hash_key(const void* key, std::size_t len) const
+        {
+            return nodes[ring.hash_key(key, len)];
+        }
+
+        // the first k distinct nodes clockwise from key, as pointers into
+        // the registry. returns how many were written.
+        std::size_t hash_n(uint64_t key, std::size_t k,
+                const descriptor_type** out) const
+        {
+            int buffer[local_replicas];
+            std::vector<int> heap;
+            int* indices = buffer;
+            if(k > (std::size_t)local_replicas)
+            {
+                heap.resize(k);
+                indices = &heap[0];
+            }
+            std::size_t count = ring.hash_n(key, k, indices);
+            for(std::size_t i = 0; i < count; ++i)
+            {
+                out[i] = &nodes[indices[i]];
+            }
+            return count;
+        }
+
+        virtual bool empty() const
+        {
+            return ring.empty();
+        }
+
+        virtual std::set<descriptor_type, Less> alive_set() const
+        {
+            std::set<int> indices = ring.alive_set();
+            std::set<descriptor_type, Less> alive;
+            for(std::set<int>::const_iterator it = indices.begin();
+                    it != indices.end(); ++it)
+            {
+                alive.insert(nodes[*it]);
+            }
+            return alive;
+        }
+
+        // the dense index ring and the registry behind it.
+        const ring_type& points() const
+        {
+            return ring;
+        }
+
+        const node_registry<descriptor_type, Less>& registry() const
+        {
+            return nodes;
+        }
+
+    private:
+        enum
+        {
+            // replica counts served without allocating.
+            local_replicas = 32
+        };
+
+        node_registry<descriptor_type, Less> nodes;
+        std::vector<uint64_t> seeds;
+        DescriptorHash hasher;
+
+        // the generator points at seeds.
+        ring_type ring;
+
+        registry_hash(const registry_hash&);
+        registry_hash& operator=(const registry_hash&);
+    };
+}
+#endif //__NODE_REGISTRY_H__
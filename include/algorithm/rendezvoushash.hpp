@@ -0,0 +1,347 @@
+#ifndef __RENDEZVOUS_HASH_H__
+#define __RENDEZVOUS_HASH_H__
+#include <stdexcept>
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <limits>
+#include <set>
+#include <vector>
+#include <stdint.h>
+#include "algorithm/keyhash.hpp"
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define RENDEZVOUS_SCORE_X86
+#endif
+namespace algorithm
+{
+    // scoring kernels of rendezvous_hash. a node's score for a key is
+    // -log2(u) / weight, u being the node's hash of the key mapped to
+    // (0, 1), and the lowest score wins (the logarithmic method). the
+    // logarithm is a table lookup in 16.16 fixed point, so every kernel
+    // returns exactly the same scores whatever the cpu.
+    namespace rendezvous_score
+    {
+        enum
+        {
+            lanes = 8
+        };
+
+        typedef void (*score_function)(uint32_t key, const uint32_t* seeds,
+                const float* inv_weights, std::size_t n, float* scores);
+
+        // log2(1 + i / 256) in 16.16 fixed point.
+        inline const int32_t* log2_table()
+        {
+            static const int32_t table[257] = {
+            0, 369, 736, 1102, 1466, 1829, 2190, 2551,
+            2909, 3267, 3623, 3978, 4331, 4683, 5034, 5384,
+            5732, 6079, 6425, 6769, 7112, 7454, 7795, 8134,
+            8473, 8810, 9146, 9480, 9814, 10146, 10477, 10807,
+            11136, 11464, 11791, 12116, 12440, 12764, 13086, 13407,
+            13727, 14046, 14363, 14680, 14996, 15310, 15624, 15937,
+            16248, 16559, 16868, 17177, 17484, 17791, 18096, 18401,
+            18704, 19007, 19308, 19609, 19909, 20207, 20505, 20802,
+            21098, 21393, 21687, 21980, 22272, 22564, 22854, 23144,
+            23433, 23720, 24007, 24293, 24579, 24863, 25146, 25429,
+            25711, 25992, 26272, 26551, 26830, 27108, 27384, 27660,
+            27936, 28210, 28484, 28757, 29029, 29300, 29571, 29840,
+            30109, 30378, 30645, 30912, 31178, 31443, 31707, 31971,
+            32234, 32496, 32758, 33019, 33279, 33538, 33797, 34055,
+            34312, 34569, 34825, 35080, 35334, 35588, 35841, 36094,
+            36346, 36597, 36847, 37097, 37346, 37595, 37842, 38090,
+            38336, 38582, 38827, 39072, 39316, 39559, 39802, 40044,
+            40286, 40527, 40767, 41006, 41246, 41484, 41722, 41959,
+            42196, 42432, 42667, 42902, 43137, 43370, 43603, 43836,
+            44068, 44300, 44530, 44761, 44990, 45220, 45448, 45676,
+            45904, 46131, 46357, 46583, 46809, 47034, 47258, 47482,
+            47705, 47928, 48150, 48372, 48593, 48813, 49034, 49253,
+            49472, 49691, 49909, 50127, 50344, 50560, 50776, 50992,
+            51207, 51422, 51636, 51850, 52063, 52276, 52488, 52700,
+            52911, 53122, 53332, 53542, 53751, 53960, 54169, 54377,
+            54584, 54791, 54998, 55204, 55410, 55615, 55820, 56025,
+            56229, 56432, 56635, 56838, 57040, 57242, 57443, 57644,
+            57845, 58045, 58245, 58444, 58643, 58841, 59039, 59237,
+            59434, 59631, 59827, 60023, 60219, 60414, 60609, 60803,
+            60997, 61190, 61384, 61576, 61769, 61961, 62152, 62343,
+            62534, 62725, 62915, 63104, 63294, 63483, 63671, 63859,
+            64047, 64234, 64421, 64608, 64794, 64980, 65166, 65351,
+            65536
+            };
+            return table;
+        }
+
+        inline uint32_t mix(uint32_t h)
+        {
+            h ^= h >> 16;
+            h *= 0x85ebca6bu;
+            h ^= h >> 13;
+            h *= 0xc2b2ae35u;
+            h ^= h >> 16;
+            return h;
+        }
+
+        inline float score(uint32_t key, uint32_t seed, float inv_weight)
+        {
+            const int32_t* table = log2_table();
+            uint32_t h = mix(key ^ seed);
+            float value = (float)(int32_t)((h >> 8) | 1);
+            uint32_t bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+            int32_t exponent = (int32_t)(bits >> 23) - 127;
+            int32_t mantissa = bits & 0x7FFFFF;
+            int32_t index = mantissa >> 15;
+            int32_t fraction = (mantissa >> 7) & 0xFF;
+            int32_t log = (exponent << 16) + table[index]
+                + (((table[index + 1] - table[index]) * fraction) >> 8);
+            return (float)((24 << 16) - log + 1) * inv_weight;
+        }
+
+        inline void scores_scalar(uint32_t key, const uint32_t* seeds,
+                const float* inv_weights, std::size_t n, float* scores)
+        {
+            for(std::size_t i = 0; i < n; ++i)
+            {
+                scores[i] = score(key, seeds[i], inv_weights[i]);
+            }
+        }
+
+#ifdef RENDEZVOUS_SCORE_X86
+        __attribute__((target("avx2")))
+        inline void scores_avx2(uint32_t key, const uint32_t* seeds,
+                const float* inv_weights, std::size_t n, float* scores)
+        {
+            const int* table = (const int*)log2_table();
+            const __m256i k = _mm256_set1_epi32((int)key);
+            const __m256i one = _mm256_set1_epi32(1);
+            const __m256i byte = _mm256_set1_epi32(0xFF);
+            for(std::size_t i = 0; i < n; i += lanes)
+            {
+                __m256i h = _mm256_xor_si256(k,
+                        _mm256_loadu_si256((const __m256i*)(seeds + i)));
+                h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 16));
+                h = _mm256_mullo_epi32(h,
+                        _mm256_set1_epi32((int)0x85ebca6bu));
+                h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 13));
+                h = _mm256_mullo_epi32(h,
+                        _mm256_set1_epi32((int)0xc2b2ae35u));
+                h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 16));
+
+                __m256i bits = _mm256_castps_si256(_mm256_cvtepi32_ps(
+                            _mm256_or_si256(_mm256_srli_epi32(h, 8), one)));
+                __m256i exponent = _mm256_sub_epi32(
+                        _mm256_srli_epi32(bits, 23), _mm256_set1_epi32(127));
+                __m256i mantissa = _mm256_and_si256(bits,
+                        _mm256_set1_epi32(0x7FFFFF));
+                __m256i index = _mm256_srli_epi32(mantissa, 15);
+                __m256i fraction = _mm256_and_si256(
+                        _mm256_srli_epi32(mantissa, 7), byte);
+                __m256i low = _mm256_i32gather_epi32(table, index, 4);
+                __m256i high = _mm256_i32gather_epi32(table + 1, index, 4);
+                __m256i log = _mm256_add_epi32(
+                        _mm256_add_epi32(_mm256_slli_epi32(exponent, 16), low),
+                        _mm256_srai_epi32(_mm256_mullo_epi32(
+                                _mm256_sub_epi32(high, low), fraction), 8));
+                __m256i fixed = _mm256_add_epi32(_mm256_sub_epi32(
+                            _mm256_set1_epi32(24 << 16), log), one);
+                _mm256_storeu_ps(scores + i, _mm256_mul_ps(
+                            _mm256_cvtepi32_ps(fixed),
+                            _mm256_loadu_ps(inv_weights + i)));
+            }
+        }
+#endif
+
+        inline score_function select()
+        {
+#ifdef RENDEZVOUS_SCORE_X86
+            __builtin_cpu_init();
+            if(__builtin_cpu_supports("avx2"))
+            {
+                return scores_avx2;
+            }
+#endif
+            return scores_scalar;
+        }
+
+        // n must be a multiple of lanes.
+        inline void scores(uint32_t key, const uint32_t* seeds,
+                const float* inv_weights, std::size_t n, float* out)
+        {
+#if defined(__AVX2__)
+            scores_avx2(key, seeds, inv_weights, n, out);
+#else
+            static const score_function kernel = select();
+            kernel(key, seeds, inv_weights, n, out);
+#endif
+        }
+    }
+
+    // weighted rendezvous (highest random weight) hashing. every lookup
+    // scores all nodes, so it suits small clusters, and removing a node
+    // only moves the keys it owned.
+    class rendezvous_hash
+    {
+    public:
+        rendezvous_hash(){}
+        virtual ~rendezvous_hash(){}
+
+        virtual void add(int id, double w)
+        {
+            if(!(w > 0))
+            {
+                throw std::invalid_argument("weight should be positive.");
+            }
+            std::vector<int>::iterator it =
+                std::lower_bound(ids.begin(), ids.end(), id);
+            std::size_t index = it - ids.begin();
+            if(it != ids.end() && *it == id)
+            {
+                weights[index] = w;
+                inv_weights[index] = (float)(1 / w);
+                return;
+            }
+            if(ids.size() >= (std::size_t)MAX_NODES)
+            {
+                throw std::range_error("too many nodes");
+            }
+            ids.insert(it, id);
+            weights.insert(weights.begin() + index, w);
+            std::size_t padded = (ids.size() + rendezvous_score::lanes - 1)
+                / rendezvous_score::lanes * rendezvous_score::lanes;
+            seeds.resize(ids.size() - 1);
+            inv_weights.resize(ids.size() - 1);
+            seeds.insert(seeds.begin() + index,
+                    (uint32_t)key_hash((uint64_t)id, 3));
+            inv_weights.insert(inv_weights.begin() + index, (float)(1 / w));
+            seeds.resize(padded, 0);
+            inv_weights.resize(padded, std::numeric_limits<float>::infinity());
+        }
+
+        virtual void erase(int id)
+        {
+            std::vector<int>::iterator it =
+                std::lower_bound(ids.begin(), ids.end(), id);
+            if(it == ids.end() || *it != id)
+            {
+                return;
+            }
+            std::size_t index = it - ids.begin();
+            ids.erase(it);
+            weights.erase(weights.begin() + index);
+            seeds.erase(seeds.begin() + index);
+            inv_weights.erase(inv_weights.begin() + index);
+            std::size_t padded = (ids.size() + rendezvous_score::lanes - 1)
+                / rendezvous_score::lanes * rendezvous_score::lanes;
+            seeds.resize(ids.size());
+            inv_weights.resize(ids.size());
+            seeds.resize(padded, 0);
+            inv_weights.resize(padded, std::numeric_limits<float>::infinity());
+        }
+
+        virtual double weight(int id) const
+        {
+            std::vector<int>::const_iterator it =
+                std::lower_bound(ids.begin(), ids.end(), id);
+            if(it == ids.end() || *it != id)
+            {
+                return 0;
+            }
+            return weights[it - ids.begin()];
+        }
+
+        virtual int hash(double resource) const
+        {
+            if(resource < 0 || resource > 1)
+            {
+                throw std::range_error("resource should be between 0"
+                        "and 1.");
+            }
+            return hash_key((uint64_t)(resource * 9007199254740992.0));
+        }
+
+        int hash_key(uint64_t key) const
+        {
+            if(empty())
+            {
+                throw std::domain_error("empty ring.");
+            }
+
+            float scores[MAX_NODES];
+            rendezvous_score::scores((uint32_t)(key_hash(key) >> 32),
+                    &seeds[0], &inv_weights[0], seeds.size(), scores);
+            std::size_t best = 0;
+            float best_score = scores[0];
+            for(std::size_t i = 1; i < ids.size(); ++i)
+            {
+                if(scores[i] < best_score)
+                {
+                    best_score = scores[i];
+                    best = i;
+                }
+            }
+            return ids[best];
+        }
+
+        int hash_key(const void* key, std::size_t len) const
+        {
+            return hash_key(key_hash(key, len));
+        }
+
+        // the k best nodes for key, best first, written to out. returns
+        // how many were written, at most the number of nodes.
+        std::size_t top(uint64_t key, std::size_t k, int* out) const
+        {
+            k = std::min(k, ids.size());
+            if(k == 0)
+            {
+                return 0;
+            }
+
+            float scores[MAX_NODES];
+            rendezvous_score::scores((uint32_t)(key_hash(key) >> 32),
+                    &seeds[0], &inv_weights[0], seeds.size(), scores);
+
+            std::size_t best[MAX_NODES];
+            std::size_t count = 0;
+            for(std::size_t i = 0; i < ids.size(); ++i)
+            {
+                if(count == k && !(scores[i] < scores[best[k - 1]]))
+                {
+                    continue;
+                }
+                std::size_t j = count < k ? count++ : k - 1;
+                for(; j > 0 && scores[i] < scores[best[j - 1]]; --j)
+                {
+                    best[j] = best[j - 1];
+                }
+                best[j] = i;
+            }
+            for(std::size_t i = 0; i < k; ++i)
+            {
+                out[i] = ids[best[i]];
+            }
+            return k;
+        }
+
+        virtual bool empty() const
+        {
+            return ids.empty();
+        }
+
+        virtual std::set<int> alive_set() const
+        {
+            return std::set<int>(ids.begin(), ids.end());
+        }
+
+        const static int MAX_NODES = 1024;
+
+    private:
+        // nodes sorted by id. seeds and inv_weights are padded to a
+        // multiple of rendezvous_score::lanes with infinite scores.
+        std::vector<int> ids;
+        std::vector<double> weights;
+        std::vector<uint32_t> seeds;
+        std::vector<float> inv_weights;
+    };
+}
+#endif //__RENDEZVOUS_HASH_H__
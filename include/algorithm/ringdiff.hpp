@@ -0,0 +1,169 @@
+#ifndef __RING_DIFF_H__
+#define __RING_DIFF_H__
+#include <stdexcept>
+#include <cstddef>
+#include <map>
+#include <vector>
+#include <stdint.h>
+#include "algorithm/consthash.hpp"
+namespace algorithm
+{
+    // key ranges that change owner between two versions of a const_hash.
+    // both rings are walked once, in point order, so the plan is exact
+    // and costs O(n + m) for rings of n and m points.
+    class ring_diff
+    {
+    public:
+        typedef const_hash::point_type point_type;
+
+        // keys whose point lies in [first, last] move from one node to
+        // another. arcs never wrap, and adjacent arcs always differ in
+        // from or to.
+        struct arc
+        {
+            point_type first;
+            point_type last;
+            int from;
+            int to;
+
+            uint64_t size() const
+            {
+                return (uint64_t)last - first + 1;
+            }
+        };
+
+        typedef std::vector<arc>::const_iterator const_iterator;
+
+        ring_diff(const const_hash& before, const const_hash& after)
+        {
+            if(before.empty() || after.empty())
+            {
+                throw std::domain_error("empty ring.");
+            }
+            merge(before, after);
+        }
+
+        virtual ~ring_diff(){}
+
+        const_iterator begin() const
+        {
+            return arcs.begin();
+        }
+
+        const_iterator end() const
+        {
+            return arcs.end();
+        }
+
+        std::size_t size() const
+        {
+            return arcs.size();
+        }
+
+        bool empty() const
+        {
+            return arcs.empty();
+        }
+
+        // points leaving and joining a node.
+        uint64_t sent(int id) const
+        {
+            std::map<int, uint64_t>::const_iterator it = outgoing.find(id);
+            return it == outgoing.end() ? 0 : it->second;
+        }
+
+        uint64_t received(int id) const
+        {
+            std::map<int, uint64_t>::const_iterator it = incoming.find(id);
+            return it == incoming.end() ? 0 : it->second;
+        }
+
+        // points changing owner, and their share of the key space.
+        uint64_t moved() const
+        {
+            return total;
+        }
+
+        double fraction() const
+        {
+            return (double)total / SPACE;
+        }
+
+        // keys map to points in [0, MAX_NODES].
+        const static uint64_t SPACE = (uint64_t)const_hash::MAX_NODES + 1;
+
+    private:
+        // the boundaries of both rings in one sorted pass. a key owned
+        // by the successor of point p, so the owners of (low, p] are the
+        // owners of the first point not below p in each ring.
+        void merge(const const_hash& before, const const_hash& after)
+        {
+            total = 0;
+            const_hash::const_iterator a = before.begin();
+            const_hash::const_iterator b = after.begin();
+            uint64_t low = 0;
+            while(a != before.end() || b != after.end())
+            {
+                point_type p;
+                if(b == after.end() || (a != before.end()
+                            && a->first <= b->first))
+                {
+                    p = a->first;
+                }
+                else
+                {
+                    p = b->first;
+                }
+                int from = a == before.end() ? before.begin()->second
+                    : a->second;
+                int to = b == after.end() ? after.begin()->second
+                    : b->second;
+                push(low, p, from, to);
+                low = (uint64_t)p + 1;
+                if(a != before.end() && a->first == p)
+                {
+                    ++a;
+                }
+                if(b != after.end() && b->first == p)
+                {
+                    ++b;
+                }
+            }
+            // keys past the last points wrap to the first ones.
+            if(low < SPACE)
+            {
+                push(low, SPACE - 1, before.begin()->second,
+                        after.begin()->second);
+            }
+        }
+
+        void push(uint64_t first, uint64_t last, int from, int to)
+        {
+            if(from == to)
+            {
+                return;
+            }
+            if(!arcs.empty() && arcs.back().last + 1 == first
+                    && arcs.back().from == from && arcs.back().to == to)
+            {
+                arcs.back().last = (point_type)last;
+            }
+            else
+            {
+                arc moving = {(point_type)first, (point_type)last, from, to};
+                arcs.push_back(moving);
+            }
+            uint64_t count = last - first + 1;
+            outgoing[from] += count;
+            incoming[to] += count;
+            total += count;
+        }
+
+        std::vector<arc> arcs;
+
+        std::map<int, uint64_t> outgoing;
+        std::map<int, uint64_t> incoming;
+        uint64_t total;
+    };
+}
+#endif //__RING_DIFF_H__
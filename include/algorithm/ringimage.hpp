@@ -0,0 +1,292 @@
+#ifndef __RING_IMAGE_H__
+#define __RING_IMAGE_H__
+#include <stdexcept>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <set>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "algorithm/consthash.hpp"
+#include "algorithm/flatring.hpp"
+#include "algorithm/keyhash.hpp"
+namespace algorithm
+{
+    // a built const_hash stored as a file that is used in place: a one
+    // page header, then the sorted points and their owners, each array
+    // starting on a boundary of the writer's page size, which the header
+    // records. loading maps the file and checks the header, lookups then
+    // search the mapped pages directly. files keep the byte order of the
+    // machine that wrote them.
+    class ring_image
+    {
+    public:
+        typedef const_hash::point_type point_type;
+
+        // maps the image at path. verify also checks the checksum of the
+        // arrays, which reads every page once.
+        explicit ring_image(const char* path, bool verify = true):
+            address(MAP_FAILED),
+            length(0),
+            points(NULL),
+            owners(NULL),
+            count(0)
+        {
+            int fd = ::open(path, O_RDONLY);
+            if(fd < 0)
+            {
+                throw std::runtime_error("cannot open ring image.");
+            }
+            struct stat info;
+            if(::fstat(fd, &info) == 0
+                    && info.st_size >= (off_t)sizeof(header))
+            {
+                length = (std::size_t)info.st_size;
+                address = ::mmap(NULL, length, PROT_READ, MAP_SHARED, fd, 0);
+            }
+            ::close(fd);
+            if(address == MAP_FAILED)
+            {
+                throw std::runtime_error("cannot map ring image.");
+            }
+            if(!check(verify))
+            {
+                ::munmap(address, length);
+                throw std::runtime_error("bad ring image.");
+            }
+        }
+
+        virtual ~ring_image()
+        {
+            ::munmap(address, length);
+        }
+
+        // writes hash to path. the image is written to a unique file
+        // beside path, synced and renamed over it, then the directory is
+        // synced, so neither a reader nor a crash leaves a partial file
+        // under path, and concurrent writers do not share a file.
+        static void save(const const_hash& hash, const char* path)
+        {
+            const uint64_t n = hash.size();
+            const std::size_t page = page_size();
+            std::vector<char> buffer(layout(n, page));
+            char* file = &buffer[0];
+            header* head = reinterpret_cast<header*>(file);
+            std::memcpy(head->magic, magic(), sizeof(head->magic));
+            head->order = ORDER;
+            head->version = VERSION;
+            head->point_bits = const_hash::POINT_BITS;
+            head->alignment = (uint32_t)page;
+            head->count = n;
+            head->points_offset = page;
+            head->owners_offset = page + round(n * sizeof(point_type), page);
+            head->size = buffer.size();
+
+            point_type* p = reinterpret_cast<point_type*>(
+                    file + head->points_offset);
+            int32_t* o = reinterpret_cast<int32_t*>(
+                    file + head->owners_offset);
+            for(const_hash::const_iterator it = hash.begin();
+                    it != hash.end(); ++it)
+            {
+                *p++ = it->first;
+                *o++ = it->second;
+            }
+            head->checksum = checksum(file, *head);
+
+            std::string pattern = std::string(path) + ".XXXXXX";
+            std::vector<char> temporary(pattern.begin(), pattern.end());
+            temporary.push_back('\0');
+            int fd = ::mkstemp(&temporary[0]);
+            if(fd < 0)
+            {
+                throw std::runtime_error("cannot write ring image.");
+            }
+            bool written = ::fchmod(fd, 0644) == 0;
+            for(std::size_t done = 0; written && done < buffer.size();)
+            {
+                ssize_t w = ::write(fd, file + done, buffer.size() - done);
+                written = w > 0;
+                done += written ? (std::size_t)w : 0;
+            }
+            written = ::fsync(fd) == 0 && written;
+            written = ::close(fd) == 0 && written;
+            if(!written || ::rename(&temporary[0], path) != 0)
+            {
+                ::unlink(&temporary[0]);
+                throw std::runtime_error("cannot write ring image.");
+            }
+            sync_directory(path);
+        }
+
+        virtual int hash(double resource) const
+        {
+            if(resource < 0 || resource > 1)
+            {
+                throw std::range_error("resource should be between 0"
+                        "and 1.");
+            }
+            return successor(const_hash::point(resource));
+        }
+
+        int hash_key(uint64_t key) const
+        {
+            return successor(const_hash::point(key));
+        }
+
+        int hash_key(const void* key, std::size_t len) const
+        {
+            return successor(const_hash::point(key, len));
+        }
+
+        virtual bool empty() const
+        {
+            return count == 0;
+        }
+
+        virtual std::set<int> alive_set() const
+        {
+            return std::set<int>(owners, owners + count);
+        }
+
+        // number of points on the ring.
+        std::size_t size() const
+        {
+            return count;
+        }
+
+        // bytes mapped, header and padding included.
+        std::size_t bytes() const
+        {
+            return length;
+        }
+
+        const static uint32_t VERSION = 1;
+
+        // alignment of images this process writes.
+        static std::size_t page_size()
+        {
+            long page = ::sysconf(_SC_PAGESIZE);
+            return page > 0 ? (std::size_t)page : 4096;
+        }
+
+    private:
+        // fixed width fields only, so the layout does not depend on the
+        // compiler. the rest of the first page is zero.
+        struct header
+        {
+            char magic[8];
+            uint32_t order;
+            uint32_t version;
+            uint32_t point_bits;
+            uint32_t alignment;
+            uint64_t count;
+            uint64_t points_offset;
+            uint64_t owners_offset;
+            uint64_t size;
+            uint64_t checksum;
+        };
+
+        static const char* magic()
+        {
+            return "CONSTRNG";
+        }
+
+        const static uint32_t ORDER = 0x01020304;
+
+        static std::size_t round(uint64_t bytes, std::size_t alignment)
+        {
+            return (std::size_t)((bytes + alignment - 1)
+                    / alignment * alignment);
+        }
+
+        static std::size_t layout(uint64_t n, std::size_t alignment)
+        {
+            return alignment + round(n * sizeof(point_type), alignment)
+                + round(n * sizeof(int32_t), alignment);
+        }
+
+        // makes the rename of an image into path durable.
+        static void sync_directory(const char* path)
+        {
+            std::string directory(path);
+            std::string::size_type slash = directory.rfind('/');
+            directory = slash == std::string::npos ? "."
+                : slash == 0 ? "/" : directory.substr(0, slash);
+            int fd = ::open(directory.c_str(), O_RDONLY);
+            if(fd >= 0)
+            {
+                ::fsync(fd);
+                ::close(fd);
+            }
+        }
+
+        // key_hash of both arrays, seeded with the point count.
+        static uint64_t checksum(const char* file, const header& head)
+        {
+            uint64_t h = key_hash(file + head.points_offset,
+                    head.count * sizeof(point_type), head.count);
+            return key_hash(file + head.owners_offset,
+                    head.count * sizeof(int32_t), h);
+        }
+
+        bool check(bool verify)
+        {
+            const char* file = static_cast<const char*>(address);
+            const header& head = *reinterpret_cast<const header*>(file);
+            std::size_t alignment = head.alignment;
+            if(std::memcmp(head.magic, magic(), sizeof(head.magic)) != 0
+                    || head.order != ORDER
+                    || head.version != VERSION
+                    || head.point_bits != (uint32_t)const_hash::POINT_BITS
+                    || alignment < sizeof(header)
+                    || (alignment & (alignment - 1)) != 0
+                    || head.size != length
+                    || head.count > (uint64_t)const_hash::MAX_NODES
+                    || head.points_offset != alignment
+                    || head.owners_offset != alignment
+                        + round(head.count * sizeof(point_type), alignment)
+                    || layout(head.count, alignment) != length)
+            {
+                return false;
+            }
+            if(verify && checksum(file, head) != head.checksum)
+            {
+                return false;
+            }
+            count = (std::size_t)head.count;
+            points = reinterpret_cast<const point_type*>(
+                    file + head.points_offset);
+            owners = reinterpret_cast<const int32_t*>(
+                    file + head.owners_offset);
+            return true;
+        }
+
+        int successor(point_type p) const
+        {
+            if(count == 0)
+            {
+                throw std::domain_error("empty ring.");
+            }
+            std::size_t index = flat_ring<point_type>::search(points, count,
+                    p);
+            return owners[index == count ? 0 : index];
+        }
+
+        void* address;
+        std::size_t length;
+
+        const point_type* points;
+        const int32_t* owners;
+        std::size_t count;
+
+        ring_image(const ring_image&);
+        ring_image& operator=(const ring_image&);
+    };
+}
+#endif //__RING_IMAGE_H__
@@ -0,0 +1,121 @@
+#ifndef __RING_SEARCH_H__
+#define __RING_SEARCH_H__
+#include <cstddef>
+#include <stdint.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define RING_SEARCH_X86
+#endif
+namespace algorithm
+{
+    // kernels counting how many of window consecutive sorted points are
+    // less than a key, used for the last levels of a ring search. every
+    // kernel returns exactly what count_less_scalar() returns.
+    namespace ring_search
+    {
+        enum
+        {
+            window = 16
+        };
+
+        typedef std::size_t (*count_function)(const uint32_t*, uint32_t);
+
+        template<typename Point>
+        inline std::size_t count_less_scalar(const Point* base, Point p)
+        {
+            std::size_t count = 0;
+            for(int i = 0; i < window; ++i)
+            {
+                count += base[i] < p;
+            }
+            return count;
+        }
+
+#ifdef RING_SEARCH_X86
+        // sse and avx2 only compare signed lanes, flipping the sign bit
+        // of both sides turns that into an unsigned compare.
+        __attribute__((target("sse4.2")))
+        inline std::size_t count_less_sse42(const uint32_t* base, uint32_t p)
+        {
+            const __m128i bias = _mm_set1_epi32((int)0x80000000u);
+            const __m128i key = _mm_xor_si128(_mm_set1_epi32((int)p), bias);
+            __m128i sum = _mm_setzero_si128();
+            for(int i = 0; i < window; i += 4)
+            {
+                __m128i x = _mm_loadu_si128((const __m128i*)(base + i));
+                x = _mm_xor_si128(x, bias);
+                sum = _mm_sub_epi32(sum, _mm_cmpgt_epi32(key, x));
+            }
+            sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+            sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+            return _mm_cvtsi128_si32(sum);
+        }
+
+        __attribute__((target("avx2,popcnt")))
+        inline std::size_t count_less_avx2(const uint32_t* base, uint32_t p)
+        {
+            const __m256i bias = _mm256_set1_epi32((int)0x80000000u);
+            const __m256i key = _mm256_xor_si256(_mm256_set1_epi32((int)p),
+                    bias);
+            __m256i low = _mm256_loadu_si256((const __m256i*)base);
+            __m256i high = _mm256_loadu_si256((const __m256i*)(base + 8));
+            low = _mm256_cmpgt_epi32(key, _mm256_xor_si256(low, bias));
+            high = _mm256_cmpgt_epi32(key, _mm256_xor_si256(high, bias));
+            unsigned int mask =
+                _mm256_movemask_ps(_mm256_castsi256_ps(low))
+                | (_mm256_movemask_ps(_mm256_castsi256_ps(high)) << 8);
+            return __builtin_popcount(mask);
+        }
+
+        __attribute__((target("avx512f,popcnt")))
+        inline std::size_t count_less_avx512(const uint32_t* base,
+                uint32_t p)
+        {
+            __m512i x = _mm512_loadu_si512((const void*)base);
+            __mmask16 mask = _mm512_cmplt_epu32_mask(x,
+                    _mm512_set1_epi32((int)p));
+            return __builtin_popcount(mask);
+        }
+#endif
+
+        // best kernel the running cpu supports.
+        inline count_function select()
+        {
+#ifdef RING_SEARCH_X86
+            __builtin_cpu_init();
+            if(__builtin_cpu_supports("avx512f"))
+            {
+                return count_less_avx512;
+            }
+            if(__builtin_cpu_supports("avx2"))
+            {
+                return count_less_avx2;
+            }
+            if(__builtin_cpu_supports("sse4.2"))
+            {
+                return count_less_sse42;
+            }
+#endif
+            return count_less_scalar<uint32_t>;
+        }
+
+        template<typename Point>
+        inline std::size_t count_less(const Point* base, Point p)
+        {
+            return count_less_scalar(base, p);
+        }
+
+        inline std::size_t count_less(const uint32_t* base, uint32_t p)
+        {
+#if defined(__AVX512F__)
+            return count_less_avx512(base, p);
+#elif defined(__AVX2__)
+            return count_less_avx2(base, p);
+#else
+            static const count_function kernel = select();
+            return kernel(base, p);
+#endif
+        }
+    }
+}
+#endif //__RING_SEARCH_H__
@@ -0,0 +1,377 @@
+#ifndef __SHARED_RING_H__
+#define __SHARED_RING_H__
+#include <stdexcept>
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <set>
+#include <fcntl.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "algorithm/consthash.hpp"
+#include "algorithm/flatring.hpp"
+namespace algorithm
+{
+    // one ring image in posix shared memory, read by every process that
+    // attaches it. the segment holds two slots: the updater fills the
+    // one readers are not using and flips a generation counter, readers
+    // search the active slot without locking and retry the rare lookup
+    // that overlapped a rewrite of its slot.
+    class shared_ring
+    {
+    public:
+        typedef const_hash::point_type point_type;
+
+        // creates the segment name with room for capacity points per
+        // slot, or attaches to it if it exists with the same capacity, so
+        // a restarted updater carries on with the generation workers
+        // already see, even if the last one died mid publish. this
+        // process becomes the updater.
+        shared_ring(const char* name, std::size_t capacity):
+            address(MAP_FAILED),
+            length(0),
+            slots(capacity),
+            head(NULL)
+        {
+            if(capacity == 0 || capacity > (std::size_t)const_hash::MAX_NODES)
+            {
+                throw std::range_error("capacity should be between 1 "
+                        "and MAX_NODES.");
+            }
+            int fd = ::shm_open(name, O_CREAT | O_RDWR, 0644);
+            if(fd < 0)
+            {
+                throw std::runtime_error("cannot create shared ring.");
+            }
+            std::size_t size = layout(capacity);
+            struct stat info;
+            if(::fstat(fd, &info) == 0)
+            {
+                length = (std::size_t)info.st_size;
+                if(length >= sizeof(header))
+                {
+                    address = ::mmap(NULL, length, PROT_READ | PROT_WRITE,
+                            MAP_SHARED, fd, 0);
+                }
+            }
+            bool existing = address != MAP_FAILED && valid(address, length);
+            if(existing && (static_cast<header*>(address)->capacity
+                        != capacity || length != size))
+            {
+                ::munmap(address, length);
+                ::close(fd);
+                throw std::runtime_error("shared ring exists with another "
+                        "capacity.");
+            }
+            if(!existing)
+            {
+                if(address != MAP_FAILED)
+                {
+                    ::munmap(address, length);
+                    address = MAP_FAILED;
+                }
+                // truncating first zeroes whatever was there.
+                if(::ftruncate(fd, 0) == 0 && ::ftruncate(fd, size) == 0)
+                {
+                    length = size;
+                    address = ::mmap(NULL, length, PROT_READ | PROT_WRITE,
+                            MAP_SHARED, fd, 0);
+                }
+            }
+            ::close(fd);
+            if(address == MAP_FAILED)
+            {
+                throw std::runtime_error("cannot map shared ring.");
+            }
+
+            head = static_cast<header*>(address);
+            if(existing)
+            {
+                // an updater that died inside publish() left the counter
+                // odd. stepping back to the even value before it keeps
+                // its slot active, which it still holds intact, and lets
+                // the next publish() start.
+                uint64_t g = __atomic_load_n(&head->generation,
+                        __ATOMIC_RELAXED);
+                while((g & 1) && !__atomic_compare_exchange_n(
+                            &head->generation, &g, g - 1, true,
+                            __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+                {
+                }
+            }
+            else
+            {
+                head->capacity = capacity;
+                head->version = VERSION;
+                __atomic_thread_fence(__ATOMIC_RELEASE);
+                std::memcpy(head->magic, magic(), sizeof(head->magic));
+            }
+        }
+
+        // attaches to the segment name read only, as a worker.
+        explicit shared_ring(const char* name):
+            address(MAP_FAILED),
+            length(0),
+            slots(0),
+            head(NULL)
+        {
+            int fd = ::shm_open(name, O_RDONLY, 0);
+            if(fd < 0)
+            {
+                throw std::runtime_error("cannot open shared ring.");
+            }
+            struct stat info;
+            if(::fstat(fd, &info) == 0
+                    && info.st_size >= (off_t)sizeof(header))
+            {
+                length = (std::size_t)info.st_size;
+                address = ::mmap(NULL, length, PROT_READ, MAP_SHARED, fd, 0);
+            }
+            ::close(fd);
+            if(address == MAP_FAILED)
+            {
+                throw std::runtime_error("cannot map shared ring.");
+            }
+
+            if(!valid(address, length))
+            {
+                ::munmap(address, length);
+                throw std::runtime_error("bad shared ring.");
+            }
+            head = static_cast<header*>(address);
+            slots = head->capacity;
+        }
+
+        // the segment outlives every process mapping it until unlink().
+        virtual ~shared_ring()
+        {
+            ::munmap(address, length);
+        }
+
+        static void unlink(const char* name)
+        {
+            ::shm_unlink(name);
+        }
+
+        // makes hash the ring every attached process reads. updaters are
+        // serialised by the generation counter itself.
+        void publish(const const_hash& hash)
+        {
+            if(hash.size() > slots)
+            {
+                throw std::range_error("ring larger than the shared "
+                        "capacity.");
+            }
+
+            uint64_t g = __atomic_load_n(&head->generation, __ATOMIC_RELAXED);
+            do
+            {
+                g &= ~(uint64_t)1;
+            }
+            while(!__atomic_compare_exchange_n(&head->generation, &g, g + 1,
+                        true, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED));
+            __atomic_thread_fence(__ATOMIC_RELEASE);
+
+            // odd: the inactive slot is being rewritten.
+            int slot = ((g >> 1) + 1) & 1;
+            point_type* p = points(slot);
+            int32_t* o = owners(slot);
+            for(const_hash::const_iterator it = hash.begin();
+                    it != hash.end(); ++it)
+            {
+                *p++ = it->first;
+                *o++ = it->second;
+            }
+            __atomic_store_n(&head->count[slot], (uint64_t)hash.size(),
+                    __ATOMIC_RELAXED);
+
+            // even again, with the rewritten slot active.
+            __atomic_store_n(&head->generation, g + 2, __ATOMIC_RELEASE);
+        }
+
+        virtual int hash(double resource) const
+        {
+            if(resource < 0 || resource > 1)
+            {
+                throw std::range_error("resource should be between 0"
+                        "and 1.");
+            }
+            return successor(const_hash::point(resource));
+        }
+
+        int hash_key(uint64_t key) const
+        {
+            return successor(const_hash::point(key));
+        }
+
+        int hash_key(const void* key, std::size_t len) const
+        {
+            return successor(const_hash::point(key, len));
+        }
+
+        virtual bool empty() const
+        {
+            return size() == 0;
+        }
+
+        virtual std::set<int> alive_set() const
+        {
+            for(;;)
+            {
+                uint64_t g = begin_read();
+                int slot = (g >> 1) & 1;
+                std::size_t n = count(slot);
+                std::set<int> ids(owners(slot), owners(slot) + n);
+                if(end_read(g))
+                {
+                    return ids;
+                }
+            }
+        }
+
+        // number of points on the ring.
+        std::size_t size() const
+        {
+            for(;;)
+            {
+                uint64_t g = begin_read();
+                std::size_t n = count((g >> 1) & 1);
+                if(end_read(g))
+                {
+                    return n;
+                }
+            }
+        }
+
+        // rings published so far.
+        uint64_t generation() const
+        {
+            return __atomic_load_n(&head->generation, __ATOMIC_ACQUIRE) >> 1;
+        }
+
+        std::size_t capacity() const
+        {
+            return slots;
+        }
+
+        // size of the segment, shared by every attached process.
+        std::size_t bytes() const
+        {
+            return length;
+        }
+
+        const static uint32_t VERSION = 1;
+
+    private:
+        struct header
+        {
+            char magic[8];
+            uint32_t version;
+            uint32_t reserved;
+            uint64_t capacity;
+            uint64_t generation;
+            uint64_t count[2];
+        };
+
+        enum
+        {
+            // the slots start on their own cache line.
+            header_bytes = 64
+        };
+
+        static const char* magic()
+        {
+            return "SHRDRING";
+        }
+
+        // a segment another updater finished setting up, whose size
+        // matches the capacity it records.
+        static bool valid(const void* address, std::size_t length)
+        {
+            const header* h = static_cast<const header*>(address);
+            return std::memcmp(h->magic, magic(), sizeof(h->magic)) == 0
+                && h->version == VERSION
+                && h->capacity != 0
+                && h->capacity <= (uint64_t)const_hash::MAX_NODES
+                && layout(h->capacity) == length;
+        }
+
+        static std::size_t layout(uint64_t capacity)
+        {
+            return header_bytes + 2 * (std::size_t)capacity
+                * (sizeof(point_type) + sizeof(int32_t));
+        }
+
+        point_type* points(int slot) const
+        {
+            char* base = static_cast<char*>(address) + header_bytes;
+            return reinterpret_cast<point_type*>(base + slot
+                    * slots * (sizeof(point_type) + sizeof(int32_t)));
+        }
+
+        int32_t* owners(int slot) const
+        {
+            return reinterpret_cast<int32_t*>(points(slot) + slots);
+        }
+
+        // a torn count is discarded by end_read(), but must not send the
+        // search past the slot first.
+        std::size_t count(int slot) const
+        {
+            uint64_t n = __atomic_load_n(&head->count[slot], __ATOMIC_RELAXED);
+            return (std::size_t)std::min(n, (uint64_t)slots);
+        }
+
+        uint64_t begin_read() const
+        {
+            return __atomic_load_n(&head->generation, __ATOMIC_ACQUIRE);
+        }
+
+        // the slot read since begin_read() returned g is rewritten only
+        // when a second update starts after the one g may show running.
+        bool end_read(uint64_t g) const
+        {
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            uint64_t h = __atomic_load_n(&head->generation, __ATOMIC_RELAXED);
+            return h <= (g | 1) + 1;
+        }
+
+        int successor(point_type p) const
+        {
+            for(;;)
+            {
+                uint64_t g = begin_read();
+                int slot = (g >> 1) & 1;
+                std::size_t n = count(slot);
+                int owner = 0;
+                if(n != 0)
+                {
+                    std::size_t index = flat_ring<point_type>::search(
+                            points(slot), n, p);
+                    owner = owners(slot)[index == n ? 0 : index];
+                }
+                if(end_read(g))
+                {
+                    if(n == 0)
+                    {
+                        throw std::domain_error("empty ring.");
+                    }
+                    return owner;
+                }
+            }
+        }
+
+        // offsets come from the capacity and length checked when the
+        // segment was mapped, never from the segment itself.
+        void* address;
+        std::size_t length;
+        std::size_t slots;
+        header* head;
+
+        shared_ring(const shared_ring&);
+        shared_ring& operator=(const shared_ring&);
+    };
+}
+#endif //__SHARED_RING_H__
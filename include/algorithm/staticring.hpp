@@ -0,0 +1,270 @@
+#ifndef __STATIC_RING_H__
+#define __STATIC_RING_H__
+#include <stdexcept>
+#include <cstddef>
+#include <stdint.h>
+#include "algorithm/consthash.hpp"
+#include "algorithm/flatring.hpp"
+// building a ring in a constant expression needs c++14 constexpr.
+#if __cplusplus >= 201402L
+namespace algorithm
+{
+    // one add(id, weight) call of a static cluster map.
+    struct static_node
+    {
+        int id;
+        int weight;
+    };
+
+    // number of points a static cluster map puts on the ring.
+    template<std::size_t Nodes>
+    constexpr std::size_t static_ring_size(const static_node (&nodes)[Nodes])
+    {
+        std::size_t size = 0;
+        for(std::size_t i = 0; i < Nodes; ++i)
+        {
+            size += nodes[i].weight > 0 ? nodes[i].weight : 0;
+        }
+        return size;
+    }
+
+    // the ring a const_hash holds after add() was called for every node
+    // of a static cluster map in turn, computed by the compiler. a
+    // constexpr static_ring at namespace scope lives in read only data,
+    // and the searches unroll for its fixed size.
+    template<std::size_t Points>
+    class static_ring
+    {
+    public:
+        typedef const_hash::point_type point_type;
+
+        constexpr static_ring():
+            points(),
+            owners()
+        {
+        }
+
+        constexpr std::size_t size() const
+        {
+            return Points;
+        }
+
+        constexpr point_type point(std::size_t index) const
+        {
+            return points[index];
+        }
+
+        constexpr int owner(std::size_t index) const
+        {
+            return owners[index];
+        }
+
+        // owner of the first point clockwise from p, the same search as
+        // lookup() in a form the compiler can evaluate.
+        constexpr int successor(point_type p) const
+        {
+            std::size_t base = 0;
+            for(std::size_t n = Points; n > 1; n -= n / 2)
+            {
+                base = points[base + n / 2] < p ? base + n / 2 : base;
+            }
+            base += points[base] < p;
+            return owners[base == Points ? 0 : base];
+        }
+
+        int hash(double resource) const
+        {
+            if(resource < 0 || resource > 1)
+            {
+                throw std::range_error("resource should be between 0"
+                        "and 1.");
+            }
+            return lookup(const_hash::point(resource));
+        }
+
+        int hash_key(uint64_t key) const
+        {
+            return lookup(const_hash::point(key));
+        }
+
+        int hash_key(const void* key, std::size_t len) const
+        {
+            return lookup(const_hash::point(key, len));
+        }
+
+        template<std::size_t Size, std::size_t Nodes>
+        friend constexpr static_ring<Size> make_static_ring(
+                const static_node (&nodes)[Nodes]);
+
+    private:
+        static_assert(Points > 0, "a static ring needs points.");
+
+        // runtime lookups finish with the simd window of flat_ring, the
+        // size being a constant lets the compiler unroll the rest.
+        int lookup(point_type p) const
+        {
+            std::size_t index = flat_ring<point_type>::search(points,
+                    Points, p);
+            return owners[index == Points ? 0 : index];
+        }
+
+        point_type points[Points];
+        int owners[Points];
+    };
+
+    // scratch space of make_static_ring(). every point is generated
+    // first, then heap sorted and the few that collide are regenerated,
+    // so a build takes O(n log n) steps and maps of tens of thousands of
+    // points stay within the compiler's default constexpr limits.
+    template<std::size_t Points>
+    class static_ring_builder
+    {
+    public:
+        typedef const_hash::point_type point_type;
+
+        constexpr static_ring_builder():
+            keys(),
+            entries()
+        {
+        }
+
+        // places the points of nodes as add() called for each in turn
+        // would: a point taken by an earlier node, or by the same node,
+        // is skipped for the next sequence of the later one.
+        template<std::size_t Nodes>
+        constexpr void build(const static_node (&nodes)[Nodes])
+        {
+            int next[Nodes] = {};
+            std::size_t size = 0;
+            for(std::size_t i = 0; i < Nodes; ++i)
+            {
+                for(std::size_t j = 0; j < i; ++j)
+                {
+                    if(nodes[j].id == nodes[i].id && nodes[j].weight > 0)
+                    {
+                        next[i] += nodes[j].weight;
+                    }
+                }
+                for(int counter = 0; counter < nodes[i].weight; ++counter)
+                {
+                    keys[size] = key(ring_point(nodes[i].id, next[i]++),
+                            size);
+                    entries[size] = i;
+                    ++size;
+                }
+            }
+
+            for(bool repaired = true; repaired;)
+            {
+                sort();
+                repaired = false;
+                point_type previous = point(0);
+                for(std::size_t k = 1; k < Points; ++k)
+                {
+                    point_type p = point(k);
+                    if(p == previous)
+                    {
+                        // generation order breaks ties, so the later
+                        // node sorted here.
+                        std::size_t i = entries[origin(k)];
+                        keys[k] = key(ring_point(nodes[i].id, next[i]++),
+                                origin(k));
+                        repaired = true;
+                    }
+                    previous = p;
+                }
+            }
+        }
+
+        constexpr point_type point(std::size_t k) const
+        {
+            return (point_type)(keys[k] >> 32);
+        }
+
+        // index into nodes of the node owning the k-th point.
+        constexpr std::size_t entry(std::size_t k) const
+        {
+            return entries[origin(k)];
+        }
+
+    private:
+        // a point and the position it was generated at, which orders
+        // points of earlier nodes first.
+        static constexpr uint64_t key(point_type p, std::size_t position)
+        {
+            return (uint64_t)p << 32 | position;
+        }
+
+        constexpr std::size_t origin(std::size_t k) const
+        {
+            return (std::size_t)(keys[k] & 0xFFFFFFFFu);
+        }
+
+        constexpr void sift(std::size_t root, std::size_t size)
+        {
+            uint64_t moving = keys[root];
+            for(std::size_t child = 2 * root + 1; child < size;
+                    child = 2 * root + 1)
+            {
+                if(child + 1 < size && keys[child] < keys[child + 1])
+                {
+                    ++child;
+                }
+                if(keys[child] <= moving)
+                {
+                    break;
+                }
+                keys[root] = keys[child];
+                root = child;
+            }
+            keys[root] = moving;
+        }
+
+        constexpr void sort()
+        {
+            for(std::size_t i = Points / 2; i > 0; --i)
+            {
+                sift(i - 1, Points);
+            }
+            for(std::size_t end = Points - 1; end > 0; --end)
+            {
+                uint64_t last = keys[end];
+                keys[end] = keys[0];
+                keys[0] = last;
+                sift(0, end);
+            }
+        }
+
+        uint64_t keys[Points];
+        std::size_t entries[Points];
+    };
+
+    // builds the ring of a static cluster map, for example
+    //     constexpr static_node nodes[] = {{1, 100}, {2, 150}};
+    //     constexpr auto ring =
+    //         make_static_ring<static_ring_size(nodes)>(nodes);
+    // a node listed twice gets its weights summed, as repeated add()
+    // calls would.
+    template<std::size_t Points, std::size_t Nodes>
+    constexpr static_ring<Points> make_static_ring(
+            const static_node (&nodes)[Nodes])
+    {
+        if(static_ring_size(nodes) != Points)
+        {
+            throw std::invalid_argument("Points should be "
+                    "static_ring_size(nodes).");
+        }
+
+        static_ring_builder<Points> builder;
+        builder.build(nodes);
+        static_ring<Points> ring;
+        for(std::size_t i = 0; i < Points; ++i)
+        {
+            ring.points[i] = builder.point(i);
+            ring.owners[i] = nodes[builder.entry(i)].id;
+        }
+        return ring;
+    }
+}
+#endif
+#endif //__STATIC_RING_H__
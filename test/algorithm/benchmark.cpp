@@ -1,10 +1,20 @@
+#include "algorithm/capacityhash.hpp"
 #include "algorithm/consthash.hpp"
+#include "algorithm/jumphash.hpp"
+#include "algorithm/multiprobehash.hpp"
+#include "algorithm/rendezvoushash.hpp"
+#include "algorithm/ringdiff.hpp"
+#include "algorithm/ringimage.hpp"
+#include "algorithm/staticring.hpp"
 
 #include <stdexcept>
 #include <cstdlib>
 #include <ctime>
 #include <iostream>
 #include <cmath>
+#include <algorithm>
+#include <cstring>
+#include <vector>
 
 using namespace algorithm;
 using namespace std;
@@ -56,9 +66,20 @@ double std_deviation (double ratio[], int size)
     return sqrt(sum/(size-zero_num));
 }
 
-int main()
+// every node in one batch, so the time is spent placing points.
+template<typename Hash>
+void batch_add(Hash& hash, int nodes, int weight)
+{
+    typename Hash::batch changes;
+    for(int i = 0; i < nodes; ++i)
+    {
+        changes.add(i, weight);
+    }
+    hash.apply(changes);
+}
+
+void distribution()
 {
-    srand(time(NULL));
     const_hash hash;
     const int node_num = 26;
     char name[node_num];
@@ -140,3 +161,647 @@ int main()
         i%=3;
     }
 }
+
+void churn()
+{
+    const int sizes[] = {100, 1000, 5000};
+    const int weight = 100;
+    const int loop = 1000;
+    for(size_t n = 0; n < sizeof(sizes)/sizeof(sizes[0]); ++n)
+    {
+        const_hash hash;
+        for(int i = 0; i < sizes[n]; ++i)
+        {
+            hash.add(i, weight);
+        }
+
+        clock_t begin = clock();
+        for(int j = 0; j < loop; ++j)
+        {
+            int id = random(0, sizes[n]);
+            hash.erase(id);
+            hash.add(id, weight);
+        }
+        double erase_time = (clock()-begin)*1000000.0/CLOCKS_PER_SEC/loop;
+
+        begin = clock();
+        for(int j = 0; j < loop; ++j)
+        {
+            int id = random(0, sizes[n]);
+            hash.remove(id, weight / 2);
+            hash.add(id, weight / 2);
+        }
+        double remove_time = (clock()-begin)*1000000.0/CLOCKS_PER_SEC/loop;
+
+        cout << "vnodes=" << sizes[n] * weight
+            << " erase+add=" << erase_time << "us"
+            << " remove+add=" << remove_time << "us" << endl;
+    }
+}
+
+void batch()
+{
+    const_hash hash(const_hash::flat_layout);
+    for(int i = 0; i < 1000; ++i)
+    {
+        hash.add(i, 200);
+    }
+
+    const int batch_size = 256;
+    const int loop = 20000;
+    vector<uint64_t> keys(batch_size);
+    vector<int> owners(batch_size);
+    long checksum = 0;
+
+    clock_t begin = clock();
+    for(int j = 0; j < loop; ++j)
+    {
+        for(int k = 0; k < batch_size; ++k)
+        {
+            keys[k] = (uint64_t)j * batch_size + k;
+        }
+        for(int k = 0; k < batch_size; ++k)
+        {
+            owners[k] = hash.hash_key(keys[k]);
+        }
+        checksum += owners[j % batch_size];
+    }
+    double scalar_time = (clock()-begin)*1000000000.0/CLOCKS_PER_SEC
+        /loop/batch_size;
+
+    begin = clock();
+    for(int j = 0; j < loop; ++j)
+    {
+        for(int k = 0; k < batch_size; ++k)
+        {
+            keys[k] = (uint64_t)j * batch_size + k;
+        }
+        hash.hash_many(&keys[0], batch_size, &owners[0]);
+        checksum -= owners[j % batch_size];
+    }
+    double batch_time = (clock()-begin)*1000000000.0/CLOCKS_PER_SEC
+        /loop/batch_size;
+
+    cout << "vnodes=200000 batch=" << batch_size
+        << " hash=" << scalar_time << "ns"
+        << " hash_many=" << batch_time << "ns"
+        << " checksum=" << checksum << endl;
+}
+
+void layouts()
+{
+    const const_hash::layout_type types[] = {const_hash::tree_layout,
+        const_hash::flat_layout, const_hash::eytzinger_layout,
+        const_hash::compact_layout};
+    const char* names[] = {"tree", "flat", "eytzinger", "compact"};
+    const int loop = 2000000;
+    for(size_t n = 0; n < sizeof(types)/sizeof(types[0]); ++n)
+    {
+        const_hash hash(types[n]);
+        batch_add(hash, 1000, 200);
+
+        long checksum = 0;
+        clock_t begin = clock();
+        for(int j = 0; j < loop; ++j)
+        {
+            checksum += hash.hash_key((uint64_t)j);
+        }
+        double elapsed = (clock()-begin)*1000000000.0/CLOCKS_PER_SEC/loop;
+        cout << "vnodes=200000 layout=" << names[n]
+            << " hash=" << elapsed << "ns"
+            << " bytes/vnode=" << hash.bytes_per_point()
+            << " checksum=" << checksum << endl;
+
+        if(types[n] != const_hash::flat_layout)
+        {
+            continue;
+        }
+        const int bits[] = {12, 16, 18, 20};
+        for(size_t b = 0; b < sizeof(bits)/sizeof(bits[0]); ++b)
+        {
+            hash.bucket_bits(bits[b]);
+            checksum = 0;
+            begin = clock();
+            for(int j = 0; j < loop; ++j)
+            {
+                checksum += hash.hash_key((uint64_t)j);
+            }
+            elapsed = (clock()-begin)*1000000000.0/CLOCKS_PER_SEC/loop;
+            cout << "vnodes=200000 layout=flat bucket_bits=" << bits[b]
+                << " table=" << hash.table_bytes() << "B"
+                << " hash=" << elapsed << "ns"
+                << " checksum=" << checksum << endl;
+        }
+    }
+}
+
+void jump()
+{
+    const int nodes = 1000;
+    const int weight = 200;
+    const int loop = 2000000;
+    const_hash ring(const_hash::flat_layout);
+    jump_hash jump;
+    for(int i = 0; i < nodes; ++i)
+    {
+        ring.add(i, weight);
+        jump.push_back(i);
+    }
+
+    long checksum = 0;
+    clock_t begin = clock();
+    for(int j = 0; j < loop; ++j)
+    {
+        checksum += ring.hash_key((uint64_t)j);
+    }
+    double ring_time = (clock()-begin)*1000000000.0/CLOCKS_PER_SEC/loop;
+
+    begin = clock();
+    for(int j = 0; j < loop; ++j)
+    {
+        checksum -= jump.hash_key((uint64_t)j);
+    }
+    double jump_time = (clock()-begin)*1000000000.0/CLOCKS_PER_SEC/loop;
+
+    cout << "nodes=" << nodes << " const_hash: hash=" << ring_time << "ns"
+        << " lookup memory=" << (size_t)nodes * weight
+        * (sizeof(const_hash::point_type) + sizeof(int)) << "B" << endl;
+    cout << "nodes=" << nodes << " jump_hash: hash=" << jump_time << "ns"
+        << " lookup memory=" << nodes * sizeof(int) << "B"
+        << " checksum=" << checksum << endl;
+}
+
+void rendezvous()
+{
+    const int sizes[] = {8, 32, 64};
+    const int loop = 2000000;
+    for(size_t n = 0; n < sizeof(sizes)/sizeof(sizes[0]); ++n)
+    {
+        const_hash ring(const_hash::flat_layout);
+        rendezvous_hash hrw;
+        for(int i = 0; i < sizes[n]; ++i)
+        {
+            ring.add(i, 200);
+            hrw.add(i, 1);
+        }
+
+        long checksum = 0;
+        clock_t begin = clock();
+        for(int j = 0; j < loop; ++j)
+        {
+            checksum += ring.hash_key((uint64_t)j);
+        }
+        double ring_time = (clock()-begin)*1000000000.0/CLOCKS_PER_SEC/loop;
+
+        begin = clock();
+        for(int j = 0; j < loop; ++j)
+        {
+            checksum -= hrw.hash_key((uint64_t)j);
+        }
+        double hrw_time = (clock()-begin)*1000000000.0/CLOCKS_PER_SEC/loop;
+
+        int replicas[3];
+        begin = clock();
+        for(int j = 0; j < loop; ++j)
+        {
+            hrw.top((uint64_t)j, 3, replicas);
+            checksum += replicas[2];
+        }
+        double top_time = (clock()-begin)*1000000000.0/CLOCKS_PER_SEC/loop;
+
+        cout << "nodes=" << sizes[n]
+            << " const_hash=" << ring_time << "ns"
+            << " rendezvous_hash=" << hrw_time << "ns"
+            << " top3=" << top_time << "ns"
+            << " checksum=" << checksum << endl;
+    }
+}
+
+void multiprobe()
+{
+    const int nodes = 100;
+    const int loop = 1000000;
+    const_hash ring(const_hash::flat_layout);
+    multiprobe_hash probe;
+    for(int i = 0; i < nodes; ++i)
+    {
+        ring.add(i, 200);
+        probe.add(i);
+    }
+
+    vector<int> count(nodes);
+    clock_t begin = clock();
+    for(int j = 0; j < loop; ++j)
+    {
+        ++count[ring.hash_key((uint64_t)j)];
+    }
+    double elapsed = (clock()-begin)*1000000000.0/CLOCKS_PER_SEC/loop;
+    cout << "nodes=" << nodes << " const_hash vnodes=" << nodes * 200
+        << " hash=" << elapsed << "ns"
+        << " peak/average=" << *max_element(count.begin(), count.end())
+        / ((double)loop / nodes) << endl;
+
+    const int probes[] = {1, 5, 21, 41};
+    for(size_t n = 0; n < sizeof(probes)/sizeof(probes[0]); ++n)
+    {
+        probe.probes(probes[n]);
+        fill(count.begin(), count.end(), 0);
+        begin = clock();
+        for(int j = 0; j < loop; ++j)
+        {
+            ++count[probe.hash_key((uint64_t)j)];
+        }
+        elapsed = (clock()-begin)*1000000000.0/CLOCKS_PER_SEC/loop;
+        cout << "nodes=" << nodes << " multiprobe_hash probes=" << probes[n]
+            << " hash=" << elapsed << "ns"
+            << " peak/average=" << *max_element(count.begin(), count.end())
+            / ((double)loop / nodes) << endl;
+    }
+}
+
+void bounded()
+{
+    const int nodes = 26;
+    const int keys = 1000000;
+    const_hash hash(const_hash::flat_layout);
+    for(int i = 0; i < nodes; ++i)
+    {
+        hash.add(i, random(100, 200));
+    }
+
+    vector<int> count(nodes);
+    for(int j = 0; j < keys; ++j)
+    {
+        ++count[hash.hash_key((uint64_t)j)];
+    }
+    cout << "unbounded peak/average="
+        << *max_element(count.begin(), count.end())
+        / ((double)keys / nodes) << endl;
+
+    const double factors[] = {0.5, 0.25, 0.1};
+    for(size_t n = 0; n < sizeof(factors)/sizeof(factors[0]); ++n)
+    {
+        hash.load_factor(factors[n]);
+        for(int i = 0; i < nodes; ++i)
+        {
+            while(hash.release(i))
+            {
+            }
+        }
+        clock_t begin = clock();
+        for(int j = 0; j < keys; ++j)
+        {
+            hash.assign(hash.hash_bounded((uint64_t)j));
+        }
+        double elapsed = (clock()-begin)*1000000000.0/CLOCKS_PER_SEC/keys;
+        long highest = 0;
+        for(int i = 0; i < nodes; ++i)
+        {
+            highest = max(highest, hash.load(i));
+        }
+        cout << "load_factor=" << factors[n]
+            << " peak/average=" << highest / ((double)keys / nodes)
+            << " hash_bounded+assign=" << elapsed << "ns" << endl;
+    }
+}
+
+void apply()
+{
+    const int sizes[] = {100, 500, 2000};
+    const int weight = 100;
+    for(size_t n = 0; n < sizeof(sizes)/sizeof(sizes[0]); ++n)
+    {
+        clock_t begin = clock();
+        const_hash one(const_hash::flat_layout);
+        for(int i = 0; i < sizes[n]; ++i)
+        {
+            one.add(i, weight);
+        }
+        double add_time = (clock()-begin)*1000.0/CLOCKS_PER_SEC;
+
+        begin = clock();
+        const_hash many(const_hash::flat_layout);
+        const_hash::batch changes;
+        for(int i = 0; i < sizes[n]; ++i)
+        {
+            changes.add(i, weight);
+        }
+        many.apply(changes);
+        double apply_time = (clock()-begin)*1000.0/CLOCKS_PER_SEC;
+
+        cout << "nodes=" << sizes[n] << " vnodes=" << sizes[n] * weight
+            << " add=" << add_time << "ms"
+            << " apply=" << apply_time << "ms" << endl;
+    }
+}
+
+void diff()
+{
+    const int node_num = 26;
+    const_hash before;
+    for(int i = 0; i < node_num; ++i)
+    {
+        before.add(i, random(100, 200));
+    }
+
+    const char* changes[] = {"add", "remove", "erase"};
+    for(int n = 0; n < 3; ++n)
+    {
+        const_hash after;
+        for(int i = 0; i < node_num; ++i)
+        {
+            after.add(i, before.weight(i));
+        }
+        int id = random(0, node_num);
+        if(n == 0)
+        {
+            after.add(node_num, 150);
+        }
+        else if(n == 1)
+        {
+            after.remove(id, before.weight(id) / 2);
+        }
+        else
+        {
+            after.erase(id);
+        }
+
+        clock_t begin = clock();
+        ring_diff plan(before, after);
+        double elapsed = (clock()-begin)*1000000.0/CLOCKS_PER_SEC;
+        cout << changes[n] << ": arcs=" << plan.size()
+            << " moved=" << plan.fraction()
+            << " plan=" << elapsed << "us" << endl;
+    }
+}
+
+void image()
+{
+    const int node_num = 500;
+    const char* path = "benchmark.ring";
+    clock_t begin = clock();
+    const_hash hash;
+    for(int i = 0; i < node_num; ++i)
+    {
+        hash.add(i, 200);
+    }
+    double build_time = (clock()-begin)*1000.0/CLOCKS_PER_SEC;
+    ring_image::save(hash, path);
+
+    const bool verify[] = {true, false};
+    for(int n = 0; n < 2; ++n)
+    {
+        begin = clock();
+        ring_image loaded(path, verify[n]);
+        int owner = loaded.hash(0.5);
+        double load_time = (clock()-begin)*1000000.0/CLOCKS_PER_SEC;
+        cout << "vnodes=" << hash.size() << " build=" << build_time << "ms"
+            << " load" << (verify[n] ? "+verify=" : "=") << load_time
+            << "us bytes=" << loaded.bytes()
+            << (owner == hash.hash(0.5) ? "" : " mismatch") << endl;
+    }
+    remove(path);
+}
+
+#if __cplusplus >= 201402L
+constexpr static_node static_nodes[] = {
+    {0, 60}, {1, 60}, {2, 60}, {3, 60}, {4, 60}, {5, 60}, {6, 60}, {7, 60},
+    {8, 60}, {9, 60}, {10, 60}, {11, 60}, {12, 60}, {13, 60}, {14, 60},
+    {15, 60}
+};
+constexpr static_ring<static_ring_size(static_nodes)> static_map =
+    make_static_ring<static_ring_size(static_nodes)>(static_nodes);
+
+void static_lookup()
+{
+    const int loop = 10000000;
+    const_hash hash(const_hash::flat_layout);
+    for(size_t i = 0; i < sizeof(static_nodes)/sizeof(static_nodes[0]); ++i)
+    {
+        hash.add(static_nodes[i].id, static_nodes[i].weight);
+    }
+
+    int sum = 0;
+    clock_t begin = clock();
+    for(int j = 0; j < loop; ++j)
+    {
+        sum += hash.hash_key((uint64_t)j);
+    }
+    double flat_time = (clock()-begin)*1000000000.0/CLOCKS_PER_SEC/loop;
+
+    begin = clock();
+    for(int j = 0; j < loop; ++j)
+    {
+        sum -= static_map.hash_key((uint64_t)j);
+    }
+    double static_time = (clock()-begin)*1000000000.0/CLOCKS_PER_SEC/loop;
+
+    cout << "vnodes=" << static_map.size() << " flat=" << flat_time << "ns"
+        << " static=" << static_time << "ns"
+        << (sum == 0 ? "" : " mismatch") << endl;
+}
+#endif
+
+// lookups through a reference, as code holding a const_hash& makes them.
+int lookup_all(const const_hash& hash, const vector<double>& resources)
+{
+    int sum = 0;
+    for(size_t j = 0; j < resources.size(); ++j)
+    {
+        sum += hash.hash(resources[j]);
+    }
+    return sum;
+}
+
+int lookup_all(const basic_const_hash<>& hash,
+        const vector<double>& resources)
+{
+    int sum = 0;
+    for(size_t j = 0; j < resources.size(); ++j)
+    {
+        sum += hash.hash(resources[j]);
+    }
+    return sum;
+}
+
+void policy()
+{
+    const int node_num = 1000;
+    const int weight = 100;
+    clock_t begin = clock();
+    const_hash virtual_hash(const_hash::flat_layout);
+    batch_add(virtual_hash, node_num, weight);
+    double virtual_add = (clock()-begin)*1000.0/CLOCKS_PER_SEC;
+
+    begin = clock();
+    basic_const_hash<> static_hash(basic_const_hash<>::flat_layout);
+    batch_add(static_hash, node_num, weight);
+    double static_add = (clock()-begin)*1000.0/CLOCKS_PER_SEC;
+
+    vector<double> resources(5000000);
+    for(size_t j = 0; j < resources.size(); ++j)
+    {
+        resources[j] = frandom();
+    }
+    begin = clock();
+    int sum = lookup_all(virtual_hash, resources);
+    double virtual_lookup = (clock()-begin)*1000000000.0/CLOCKS_PER_SEC
+        / resources.size();
+    begin = clock();
+    sum -= lookup_all(static_hash, resources);
+    double static_lookup = (clock()-begin)*1000000000.0/CLOCKS_PER_SEC
+        / resources.size();
+
+    cout << "vnodes=" << node_num * weight
+        << " const_hash add=" << virtual_add << "ms"
+        << " hash=" << virtual_lookup << "ns" << endl
+        << "vnodes=" << node_num * weight
+        << " basic_const_hash add=" << static_add << "ms"
+        << " hash=" << static_lookup << "ns"
+        << (sum == 0 ? "" : " mismatch") << endl;
+}
+
+void alive()
+{
+    const int node_num = 1000;
+    const int loop = 10000;
+    const_hash hash;
+    batch_add(hash, node_num, 10);
+
+    long found = 0;
+    clock_t begin = clock();
+    for(int j = 0; j < loop; ++j)
+    {
+        found += hash.alive_set().count(j % node_num);
+    }
+    double set_time = (clock()-begin)*1000000.0/CLOCKS_PER_SEC/loop;
+
+    begin = clock();
+    for(int j = 0; j < loop; ++j)
+    {
+        found -= hash.alive().contains(j % node_num);
+    }
+    double view_time = (clock()-begin)*1000000.0/CLOCKS_PER_SEC/loop;
+
+    cout << "nodes=" << node_num << " alive_set=" << set_time << "us"
+        << " alive=" << view_time << "us"
+        << (found == 0 ? "" : " mismatch") << endl;
+}
+
+void capacity()
+{
+    const int node_num = 100;
+    const int loop = 1000000;
+    capacity_hash::capacity_map capacities;
+    const_hash fixed(const_hash::flat_layout);
+    const_hash::batch changes;
+    for(int i = 0; i < node_num; ++i)
+    {
+        capacities[i] = random(100, 400);
+        changes.add(i, (int)capacities[i]);
+    }
+    fixed.apply(changes);
+
+    long sum = 0;
+    clock_t begin = clock();
+    for(int j = 0; j < loop; ++j)
+    {
+        sum += fixed.hash(frandom());
+    }
+    double lookup_time = (clock()-begin)*1000000000.0/CLOCKS_PER_SEC/loop;
+    cout << "vnodes=capacity points=" << fixed.size() << " imbalance="
+        << capacity_hash::imbalance(fixed, capacities) << " lookup="
+        << lookup_time << "ns" << endl;
+
+    const double targets[] = {0.2, 0.1};
+    for(int t = 0; t < 2; ++t)
+    {
+        begin = clock();
+        capacity_hash sized(targets[t]);
+        sized.assign(capacities);
+        double build_time = (clock()-begin)*1000.0/CLOCKS_PER_SEC;
+
+        begin = clock();
+        for(int j = 0; j < loop; ++j)
+        {
+            sum += sized.hash(frandom());
+        }
+        lookup_time = (clock()-begin)*1000000000.0/CLOCKS_PER_SEC/loop;
+        cout << "target=" << sized.target() << " points=" << sized.size()
+            << " imbalance=" << sized.imbalance() << " lookup="
+            << lookup_time << "ns build=" << build_time << "ms" << endl;
+    }
+    // keeps the lookups from being optimised away.
+    if(sum < 0)
+    {
+        cout << sum << endl;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    srand(time(NULL));
+    if(argc > 1 && strcmp(argv[1], "churn") == 0)
+    {
+        churn();
+    }
+    else if(argc > 1 && strcmp(argv[1], "batch") == 0)
+    {
+        batch();
+    }
+    else if(argc > 1 && strcmp(argv[1], "layout") == 0)
+    {
+        layouts();
+    }
+    else if(argc > 1 && strcmp(argv[1], "jump") == 0)
+    {
+        jump();
+    }
+    else if(argc > 1 && strcmp(argv[1], "rendezvous") == 0)
+    {
+        rendezvous();
+    }
+    else if(argc > 1 && strcmp(argv[1], "multiprobe") == 0)
+    {
+        multiprobe();
+    }
+    else if(argc > 1 && strcmp(argv[1], "bounded") == 0)
+    {
+        bounded();
+    }
+    else if(argc > 1 && strcmp(argv[1], "apply") == 0)
+    {
+        apply();
+    }
+    else if(argc > 1 && strcmp(argv[1], "diff") == 0)
+    {
+        diff();
+    }
+    else if(argc > 1 && strcmp(argv[1], "image") == 0)
+    {
+        image();
+    }
+    else if(argc > 1 && strcmp(argv[1], "policy") == 0)
+    {
+        policy();
+    }
+    else if(argc > 1 && strcmp(argv[1], "alive") == 0)
+    {
+        alive();
+    }
+    else if(argc > 1 && strcmp(argv[1], "capacity") == 0)
+    {
+        capacity();
+    }
+#if __cplusplus >= 201402L
+    else if(argc > 1 && strcmp(argv[1], "static") == 0)
+    {
+        static_lookup();
+    }
+#endif
+    else
+    {
+        distribution();
+    }
+    return 0;
+}
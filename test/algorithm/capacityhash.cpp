@@ -0,0 +1,186 @@
+#include "algorithm/capacityhash.hpp"
+#include "tut/tut.hpp"
+#include "tut/tut_macros.hpp"
+#include <cstdlib>
+#include <map>
+
+namespace
+{
+    struct data
+    {
+        uint64_t key()
+        {
+            return ((uint64_t)rand() << 32) | rand();
+        }
+    };
+    typedef tut::test_group<data> group;
+    group g("capacity_hash");
+
+    typedef group::object fixture;
+}
+
+namespace tut
+{
+    template<>
+    template<>
+    void fixture::test<1>()
+    {
+        set_test_name("vnodes follow capacity");
+        algorithm::capacity_hash hash(0.1);
+        ensure("empty", hash.empty());
+        ensure_THROW(hash.add(1, 0), std::invalid_argument);
+        ensure_THROW(algorithm::capacity_hash(0), std::range_error);
+
+        for(int i = 0; i < 8; ++i)
+        {
+            hash.add(i, 100 + 50 * (i % 3));
+        }
+        ensure_equals("nodes", hash.alive().size(), 8u);
+        ensure("target met", hash.imbalance() <= 0.1);
+        ensure_equals("capacity", hash.capacity(2), 200.0);
+        ensure_equals("unknown", hash.capacity(9), 0.0);
+        ensure("proportional", hash.weight(2) > hash.weight(0));
+        ensure("proportional", hash.weight(1) > hash.weight(0));
+        ensure("bounded", hash.size() <=
+                (std::size_t)algorithm::capacity_hash::MAX_POINTS);
+
+        algorithm::capacity_hash::capacity_map capacities;
+        for(int i = 0; i < 8; ++i)
+        {
+            capacities[i] = hash.capacity(i);
+        }
+        ensure_equals("measured", hash.imbalance(),
+                algorithm::capacity_hash::imbalance(hash.points(),
+                    capacities));
+    }
+
+    template<>
+    template<>
+    void fixture::test<2>()
+    {
+        set_test_name("looser targets give smaller rings");
+        algorithm::capacity_hash tight(0.05);
+        algorithm::capacity_hash loose(0.5);
+        for(int i = 0; i < 10; ++i)
+        {
+            tight.add(i, 10 + i);
+            loose.add(i, 10 + i);
+        }
+        ensure("tight met", tight.imbalance() <= 0.05);
+        ensure("loose met", loose.imbalance() <= 0.5);
+        ensure("smaller", loose.size() < tight.size());
+
+        // one search over every node finds a ring no larger than adding
+        // them one by one.
+        algorithm::capacity_hash assigned(0.05);
+        algorithm::capacity_hash::capacity_map capacities;
+        for(int i = 0; i < 10; ++i)
+        {
+            capacities[i] = 10 + i;
+        }
+        assigned.assign(capacities);
+        ensure("assign met", assigned.imbalance() <= 0.05);
+        ensure("assign not larger", assigned.size() <= tight.size());
+        capacities[3] = 0;
+        ensure_THROW(assigned.assign(capacities), std::invalid_argument);
+        capacities.clear();
+        assigned.assign(capacities);
+        ensure("assign empty", assigned.empty());
+
+        // a node alone owns the whole ring with one point.
+        algorithm::capacity_hash single;
+        single.add(7, 3.5);
+        ensure_equals("one point", single.size(), 1u);
+        ensure_equals("owner", single.hash_key(key()), 7);
+    }
+
+    template<>
+    template<>
+    void fixture::test<3>()
+    {
+        set_test_name("rebalances on membership changes");
+        algorithm::capacity_hash hash(0.2);
+        for(int i = 0; i < 6; ++i)
+        {
+            hash.add(i, 100);
+        }
+        std::map<uint64_t, int> owners;
+        for(int i = 0; i < 1000; ++i)
+        {
+            uint64_t k = key();
+            owners[k] = hash.hash_key(k);
+        }
+
+        hash.add(6, 300);
+        ensure("target met", hash.imbalance() <= 0.2);
+        ensure("larger node", hash.weight(6) > hash.weight(0));
+        int joined = 0;
+        for(std::map<uint64_t, int>::const_iterator it = owners.begin();
+                it != owners.end(); ++it)
+        {
+            joined += hash.hash_key(it->first) == 6;
+        }
+        ensure("new node takes keys", joined > 0);
+
+        hash.add(6, 100);
+        ensure("target met", hash.imbalance() <= 0.2);
+        hash.erase(6);
+        hash.erase(42);
+        ensure_equals("nodes", hash.alive().size(), 6u);
+        ensure_equals("gone", hash.weight(6), 0);
+        ensure("target met", hash.imbalance() <= 0.2);
+        for(int i = 0; i < 6; ++i)
+        {
+            hash.erase(i);
+        }
+        ensure("empty", hash.empty());
+        ensure_equals("no points", hash.size(), 0u);
+    }
+
+    template<>
+    template<>
+    void fixture::test<4>()
+    {
+        set_test_name("only the changed node moves keys");
+        algorithm::capacity_hash hash(0.25);
+        for(int i = 0; i < 20; ++i)
+        {
+            hash.add(i, 100 + 10 * i);
+        }
+        const int count = 20000;
+        std::map<uint64_t, int> owners;
+        for(int i = 0; i < count; ++i)
+        {
+            uint64_t k = key();
+            owners[k] = hash.hash_key(k);
+        }
+
+        hash.add(20, 150);
+        int joined = 0, moved = 0;
+        for(std::map<uint64_t, int>::iterator it = owners.begin();
+                it != owners.end(); ++it)
+        {
+            int owner = hash.hash_key(it->first);
+            joined += owner == 20;
+            moved += owner != it->second && owner != 20;
+            it->second = owner;
+        }
+        ensure("new node takes keys", joined > 0);
+        ensure("others keep theirs", moved <= count / 100);
+        ensure("target met", hash.imbalance() <= 0.25);
+
+        hash.erase(7);
+        int left = 0;
+        moved = 0;
+        for(std::map<uint64_t, int>::iterator it = owners.begin();
+                it != owners.end(); ++it)
+        {
+            int owner = hash.hash_key(it->first);
+            left += it->second == 7;
+            moved += owner != it->second && it->second != 7;
+        }
+        ensure("erased node gives keys", left > 0);
+        ensure("others keep theirs", moved <= count / 100);
+        ensure("target met", hash.imbalance() <= 0.25);
+    }
+}
@@ -0,0 +1,165 @@
+#include "algorithm/concurrentconsthash.hpp"
+#include "tut/tut.hpp"
+#include "tut/tut_macros.hpp"
+#include <cstdlib>
+#include <pthread.h>
+
+namespace
+{
+    struct data
+    {
+        uint64_t key()
+        {
+            return ((uint64_t)rand() << 32) | rand();
+        }
+    };
+    typedef tut::test_group<data> group;
+    group g("concurrent_const_hash");
+
+    typedef group::object fixture;
+
+    // looks keys up until told to stop, counting answers that are not
+    // one of the two nodes the writer never removes.
+    struct reader
+    {
+        const algorithm::concurrent_const_hash* hash;
+        bool stop;
+        long lookups;
+        long wrong;
+    };
+
+    void* read(void* arg)
+    {
+        reader* r = static_cast<reader*>(arg);
+        uint64_t key = (uint64_t)(std::size_t)arg;
+        while(!__atomic_load_n(&r->stop, __ATOMIC_ACQUIRE))
+        {
+            key = key * 6364136223846793005ull + 1442695040888963407ull;
+            int id = r->hash->hash_key(key);
+            if(id != 1 && id != 2 && (id < 100 || id >= 110))
+            {
+                ++r->wrong;
+            }
+            ++r->lookups;
+        }
+        return NULL;
+    }
+}
+
+namespace tut
+{
+    template<>
+    template<>
+    void fixture::test<1>()
+    {
+        set_test_name("construct object");
+        algorithm::concurrent_const_hash hash;
+        ensure("default hash empty", hash.empty());
+        ensure("default alive_set empty", hash.alive_set().empty());
+        ensure_THROW(hash.hash(0.5), std::domain_error);
+        ensure_THROW(hash.hash(2), std::range_error);
+    }
+
+    template<>
+    template<>
+    void fixture::test<2>()
+    {
+        set_test_name("same owners as const_hash");
+        algorithm::const_hash plain;
+        algorithm::concurrent_const_hash hash;
+        for(int id = 0; id < 20; ++id)
+        {
+            plain.add(id, 50);
+            hash.add(id, 50);
+        }
+        plain.remove(3, 20);
+        hash.remove(3, 20);
+        plain.erase(7);
+        hash.erase(7);
+
+        ensure("alive_set", hash.alive_set() == plain.alive_set());
+        ensure_equals("weight", hash.weight(3), 30);
+        ensure_equals("erased weight", hash.weight(7), 0);
+        for(int i = 0; i < 10000; ++i)
+        {
+            uint64_t k = key();
+            ensure_equals("key", hash.hash_key(k), plain.hash_key(k));
+            ensure_equals("bytes", hash.hash_key(&k, sizeof(k)),
+                    plain.hash_key(&k, sizeof(k)));
+        }
+        for(double r = 0; r <= 1; r += 0.001)
+        {
+            ensure_equals("resource", hash.hash(r), plain.hash(r));
+        }
+    }
+
+    template<>
+    template<>
+    void fixture::test<3>()
+    {
+        set_test_name("readers during updates");
+        algorithm::concurrent_const_hash hash;
+        hash.add(1, 100);
+        hash.add(2, 100);
+
+        const int count = 4;
+        reader readers[count];
+        pthread_t threads[count];
+        for(int i = 0; i < count; ++i)
+        {
+            readers[i].hash = &hash;
+            readers[i].stop = false;
+            readers[i].lookups = 0;
+            readers[i].wrong = 0;
+            pthread_create(&threads[i], NULL, read, &readers[i]);
+        }
+
+        for(int round = 0; round < 200; ++round)
+        {
+            int id = 100 + round % 10;
+            hash.add(id, 20);
+            hash.erase(id);
+        }
+
+        long wrong = 0;
+        for(int i = 0; i < count; ++i)
+        {
+            __atomic_store_n(&readers[i].stop, true, __ATOMIC_RELEASE);
+            pthread_join(threads[i], NULL);
+            wrong += readers[i].wrong;
+        }
+        ensure_equals("no stray owners", wrong, 0);
+        ensure_equals("back to two nodes", hash.alive_set().size(), 2u);
+
+        // with every reader gone the next update frees all snapshots.
+        hash.add(3, 1);
+        ensure_equals("reclaimed", hash.pending(), 0u);
+    }
+
+    template<>
+    template<>
+    void fixture::test<4>()
+    {
+        set_test_name("batch apply");
+        algorithm::const_hash plain;
+        algorithm::concurrent_const_hash hash;
+        algorithm::concurrent_const_hash::batch changes;
+        for(int id = 0; id < 20; ++id)
+        {
+            plain.add(id, 30);
+            changes.add(id, 30);
+        }
+        plain.erase(5);
+        changes.erase(5);
+        hash.apply(changes);
+
+        ensure("alive_set", hash.alive_set() == plain.alive_set());
+        for(int i = 0; i < 5000; ++i)
+        {
+            uint64_t k = key();
+            ensure_equals("key", hash.hash_key(k), plain.hash_key(k));
+        }
+        ensure_equals("one snapshot retired", hash.pending(), 0u);
+    }
+}
+
@@ -1,6 +1,11 @@
 #include "algorithm/consthash.hpp"
 #include "tut/tut.hpp"
 #include "tut/tut_macros.hpp"
+#include <cmath>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
 
 namespace
 {
@@ -30,6 +35,20 @@ namespace
             return r/RAND_MAX;
         }
     };
+
+    struct exposed_hash : public algorithm::const_hash
+    {
+        explicit exposed_hash(layout_type layout = tree_layout):
+            algorithm::const_hash(layout)
+        {
+        }
+
+        point_type point(int x, int y)
+        {
+            return random(x, y);
+        }
+    };
+
     typedef tut::test_group<data> group;
     group g("const_hash");
 
@@ -269,5 +288,711 @@ namespace tut
             ensure_equals(hash1.hash(r), hash2.hash(r));
         }
     }
-}
 
+    template<>
+    template<>
+    void fixture::test<8>()
+    {
+        set_test_name("flat layout matches tree layout");
+        algorithm::const_hash tree;
+        algorithm::const_hash flat(algorithm::const_hash::flat_layout);
+        ensure("flat layout", 
+                flat.layout() == algorithm::const_hash::flat_layout);
+        ensure_THROW(flat.hash(0.5), std::domain_error);
+        int nodes = random(1, 50);
+        for(int i = 0; i < nodes; ++i)
+        {
+            int weight = random(1, 200);
+            tree.add(i, weight);
+            flat.add(i, weight);
+        }
+        tree.remove(0, 10);
+        flat.remove(0, 10);
+        tree.erase(nodes / 2);
+        flat.erase(nodes / 2);
+        ensure_equals("flat empty", flat.empty(), tree.empty());
+        if(tree.empty())
+        {
+            return;
+        }
+
+        ensure_equals("hash 0", flat.hash(0), tree.hash(0));
+        ensure_equals("hash 1", flat.hash(1), tree.hash(1));
+        int loop = 10000;
+        for(int i = 0; i < loop; ++i)
+        {
+            double r = random();
+            ensure_equals("flat owner", flat.hash(r), tree.hash(r));
+        }
+        ensure_THROW(flat.hash(2), std::range_error);
+    }
+
+    template<>
+    template<>
+    void fixture::test<9>()
+    {
+        set_test_name("weight tracks add remove and erase");
+        algorithm::const_hash hash;
+        hash.add(0, 0);
+        ensure_equals("zero weight node", hash.weight(0), 0);
+        ensure("zero weight node not alive", hash.alive_set().empty());
+        ensure_equals("remove unknown node", hash.remove(3, 10), 0);
+
+        hash.add(0, 50);
+        hash.add(0, 50);
+        hash.add(1, 20);
+        ensure_equals("node 0 weight", hash.weight(0), 100);
+        ensure_equals("node 1 weight", hash.weight(1), 20);
+        ensure_equals("remove returns weight", hash.remove(0, 30), 70);
+        ensure_equals("node 0 weight", hash.weight(0), 70);
+        hash.add(0, 30);
+        ensure_equals("node 0 weight", hash.weight(0), 100);
+        hash.erase(0);
+        ensure_equals("node 0 weight", hash.weight(0), 0);
+        hash.add(0, 10);
+        ensure_equals("node 0 weight", hash.weight(0), 10);
+        ensure_equals("node 1 weight", hash.weight(1), 20);
+    }
+
+    template<>
+    template<>
+    void fixture::test<10>()
+    {
+        set_test_name("large ring with colliding points");
+        algorithm::const_hash hash;
+        int nodes = 1000;
+        for(int i = 0; i < nodes; ++i)
+        {
+            hash.add(i, 200);
+        }
+        for(int i = 0; i < nodes; ++i)
+        {
+            ensure_equals("node weight", hash.weight(i), 200);
+        }
+        for(int i = 0; i < nodes; i += 2)
+        {
+            hash.erase(i);
+            ensure_equals("remove weight", hash.remove(i + 1, 150), 50);
+        }
+        ensure_equals("alive nodes", hash.alive_set().size(), nodes / 2);
+        for(int i = 0; i < nodes; ++i)
+        {
+            ensure_equals("node weight", hash.weight(i), i % 2 ? 50 : 0);
+        }
+        int loop = 1000;
+        for(int i = 0; i < loop; ++i)
+        {
+            ensure("odd owner", hash.hash(random()) % 2 == 1);
+        }
+    }
+
+    template<>
+    template<>
+    void fixture::test<11>()
+    {
+        set_test_name("integer ring matches double positions");
+        const int max = algorithm::const_hash::MAX_NODES;
+        exposed_hash hashes[2] = {exposed_hash(),
+            exposed_hash(algorithm::const_hash::flat_layout)};
+        std::map<double, int> expected;
+        int nodes = random(1, 30);
+        for(int i = 0; i < nodes; ++i)
+        {
+            int weight = random(1, 100);
+            for(int counter = 0, sequence = 0; counter < weight; ++sequence)
+            {
+                double position = (double)hashes[0].point(i, sequence) / max;
+                if(expected.insert(std::make_pair(position, i)).second)
+                {
+                    ++counter;
+                }
+            }
+            hashes[0].add(i, weight);
+            hashes[1].add(i, weight);
+        }
+
+        std::vector<double> probes;
+        probes.push_back(0);
+        probes.push_back(1);
+        for(std::map<double, int>::const_iterator it = expected.begin();
+                it != expected.end(); ++it)
+        {
+            probes.push_back(it->first);
+            probes.push_back(nextafter(it->first, 0.0));
+            probes.push_back(nextafter(it->first, 1.0));
+        }
+        for(int i = 0; i < 1000; ++i)
+        {
+            probes.push_back(random());
+        }
+
+        for(size_t i = 0; i < probes.size(); ++i)
+        {
+            std::map<double, int>::const_iterator it =
+                expected.lower_bound(probes[i]);
+            if(it == expected.end())
+            {
+                it = expected.begin();
+            }
+            ensure_equals("tree owner", hashes[0].hash(probes[i]), it->second);
+            ensure_equals("flat owner", hashes[1].hash(probes[i]), it->second);
+        }
+    }
+
+    template<>
+    template<>
+    void fixture::test<12>()
+    {
+        set_test_name("hash integer and byte keys");
+        algorithm::const_hash tree;
+        algorithm::const_hash flat(algorithm::const_hash::flat_layout);
+        ensure_THROW(tree.hash_key(uint64_t(1)), std::domain_error);
+        ensure_THROW(flat.hash_key("key", 3), std::domain_error);
+        int nodes = random(1, 20);
+        for(int i = 0; i < nodes; ++i)
+        {
+            int weight = random(100, 200);
+            tree.add(i, weight);
+            flat.add(i, weight);
+        }
+
+        int loop = 10000;
+        for(int i = 0; i < loop; ++i)
+        {
+            uint64_t key = ((uint64_t)rand() << 32) | rand();
+            int owner = tree.hash_key(key);
+            ensure("owner alive", tree.alive_set().count(owner) == 1);
+            ensure_equals("flat key owner", flat.hash_key(key), owner);
+            ensure_equals("byte key owner", flat.hash_key(&key, sizeof(key)),
+                    tree.hash_key(&key, sizeof(key)));
+        }
+
+        const char text[] = "the quick brown fox jumps over the lazy dog, "
+            "then hashes a long string";
+        for(size_t len = 0; len < sizeof(text); ++len)
+        {
+            ensure_equals("text owner", flat.hash_key(text, len),
+                    tree.hash_key(text, len));
+            ensure_equals("text hash deterministic",
+                    algorithm::key_hash(text, len),
+                    algorithm::key_hash(std::string(text, len).data(), len));
+        }
+        ensure("text hash spreads", algorithm::key_hash(text, 10)
+                != algorithm::key_hash(text, 11));
+    }
+
+    template<>
+    template<>
+    void fixture::test<13>()
+    {
+        set_test_name("hash_many matches hash");
+        algorithm::const_hash tree;
+        algorithm::const_hash flat(algorithm::const_hash::flat_layout);
+        uint64_t key = 1;
+        int owner = -1;
+        ensure_THROW(flat.hash_many(&key, 1, &owner), std::domain_error);
+        int nodes = random(1, 50);
+        for(int i = 0; i < nodes; ++i)
+        {
+            int weight = random(1, 200);
+            tree.add(i, weight);
+            flat.add(i, weight);
+        }
+
+        std::vector<uint64_t> keys(random(1, 2000));
+        for(size_t i = 0; i < keys.size(); ++i)
+        {
+            keys[i] = ((uint64_t)rand() << 32) | rand();
+        }
+        std::vector<int> tree_owners(keys.size()), flat_owners(keys.size());
+        tree.hash_many(&keys[0], keys.size(), &tree_owners[0]);
+        flat.hash_many(&keys[0], keys.size(), &flat_owners[0]);
+        for(size_t i = 0; i < keys.size(); ++i)
+        {
+            ensure_equals("tree batch owner", tree_owners[i],
+                    tree.hash_key(keys[i]));
+            ensure_equals("flat batch owner", flat_owners[i],
+                    tree.hash_key(keys[i]));
+        }
+    }
+
+    template<>
+    template<>
+    void fixture::test<14>()
+    {
+        set_test_name("eytzinger layout matches tree layout");
+        algorithm::const_hash tree;
+        algorithm::const_hash eytzinger(
+                algorithm::const_hash::eytzinger_layout);
+        ensure_THROW(eytzinger.hash(0.5), std::domain_error);
+        int nodes = random(1, 50);
+        for(int i = 0; i < nodes; ++i)
+        {
+            int weight = random(1, 200);
+            tree.add(i, weight);
+            eytzinger.add(i, weight);
+        }
+        tree.remove(0, 10);
+        eytzinger.remove(0, 10);
+        if(tree.empty())
+        {
+            return;
+        }
+
+        ensure_equals("hash 0", eytzinger.hash(0), tree.hash(0));
+        ensure_equals("hash 1", eytzinger.hash(1), tree.hash(1));
+        int loop = 10000;
+        for(int i = 0; i < loop; ++i)
+        {
+            double r = random();
+            ensure_equals("eytzinger owner", eytzinger.hash(r), tree.hash(r));
+            uint64_t key = ((uint64_t)rand() << 32) | rand();
+            ensure_equals("eytzinger key owner", eytzinger.hash_key(key),
+                    tree.hash_key(key));
+        }
+    }
+
+    template<>
+    template<>
+    void fixture::test<15>()
+    {
+        set_test_name("bucket table matches tree layout");
+        algorithm::const_hash tree;
+        algorithm::const_hash flat(algorithm::const_hash::flat_layout);
+        ensure_THROW(tree.bucket_bits(8), std::logic_error);
+        ensure_THROW(flat.bucket_bits(-1), std::range_error);
+        ensure_THROW(flat.bucket_bits(25), std::range_error);
+        ensure_equals("no table", flat.table_bytes(), 0);
+
+        flat.bucket_bits(4);
+        ensure_equals("bucket bits", flat.bucket_bits(), 4);
+        ensure_equals("table bytes", flat.table_bytes(), 17 * 4);
+        int nodes = random(1, 50);
+        for(int i = 0; i < nodes; ++i)
+        {
+            int weight = random(1, 200);
+            tree.add(i, weight);
+            flat.add(i, weight);
+        }
+
+        int bits[] = {0, 1, 4, 10, 16, 24};
+        for(size_t b = 0; b < sizeof(bits)/sizeof(bits[0]); ++b)
+        {
+            flat.bucket_bits(bits[b]);
+            ensure_equals("hash 0", flat.hash(0), tree.hash(0));
+            ensure_equals("hash 1", flat.hash(1), tree.hash(1));
+            int loop = 2000;
+            for(int i = 0; i < loop; ++i)
+            {
+                double r = random();
+                ensure_equals("bucket owner", flat.hash(r), tree.hash(r));
+                uint64_t key = ((uint64_t)rand() << 32) | rand();
+                ensure_equals("bucket key owner", flat.hash_key(key),
+                        tree.hash_key(key));
+                int owner = -1;
+                flat.hash_many(&key, 1, &owner);
+                ensure_equals("bucket batch owner", owner, tree.hash_key(key));
+            }
+        }
+        flat.bucket_bits(10);
+        flat.erase(0);
+        tree.erase(0);
+        if(!tree.empty())
+        {
+            for(int i = 0; i < 1000; ++i)
+            {
+                double r = random();
+                ensure_equals("rebuilt owner", flat.hash(r), tree.hash(r));
+            }
+        }
+    }
+
+    template<>
+    template<>
+    void fixture::test<16>()
+    {
+        set_test_name("bounded load lookups");
+        algorithm::const_hash tree;
+        algorithm::const_hash flat(algorithm::const_hash::flat_layout);
+        algorithm::const_hash compact(algorithm::const_hash::compact_layout);
+        ensure_THROW(tree.hash_bounded(uint64_t(1)), std::domain_error);
+        ensure_THROW(tree.assign(1), std::invalid_argument);
+        ensure_THROW(tree.release(1), std::invalid_argument);
+        ensure_THROW(tree.load_factor(-1), std::range_error);
+        ensure_equals("default load factor", tree.load_factor(), 0.25);
+
+        int nodes = 10;
+        for(int i = 0; i < nodes; ++i)
+        {
+            tree.add(i, 100);
+            flat.add(i, 100);
+            compact.add(i, 100);
+        }
+        tree.load_factor(0.1);
+        flat.load_factor(0.1);
+        compact.load_factor(0.1);
+
+        int keys = 10000;
+        for(int i = 0; i < keys; ++i)
+        {
+            uint64_t key = ((uint64_t)rand() << 32) | rand();
+            int owner = tree.hash_bounded(key);
+            ensure_equals("flat bounded owner", flat.hash_bounded(key), owner);
+            ensure_equals("compact bounded owner", compact.hash_bounded(key),
+                    owner);
+            tree.assign(owner);
+            flat.assign(owner);
+            compact.assign(owner);
+        }
+        ensure_equals("total load", tree.total_load(), keys);
+        long cap = (long)std::ceil(1.1 * keys / nodes);
+        for(int i = 0; i < nodes; ++i)
+        {
+            ensure("load under cap", tree.load(i) <= cap);
+        }
+
+        long load = tree.load(3);
+        ensure("released", tree.release(3));
+        ensure_equals("released load", tree.load(3), load - 1);
+        ensure_equals("released total", tree.total_load(), keys - 1);
+        tree.assign(3);
+        tree.erase(3);
+        ensure_equals("erased node load", tree.load(3), 0);
+        ensure_equals("total without node", tree.total_load(), keys - load);
+        tree.remove(4, 100);
+        ensure_equals("removed node load", tree.load(4), 0);
+        ensure_equals("total without nodes", tree.total_load(),
+                keys - load - flat.load(4));
+
+        // a release with nothing placed does not take from the others.
+        tree.add(42, 10);
+        ensure("nothing to release", !tree.release(42));
+        ensure_equals("load stays zero", tree.load(42), 0);
+        ensure_equals("total unchanged", tree.total_load(),
+                keys - load - flat.load(4));
+        tree.assign(42);
+        ensure("release placed", tree.release(42));
+        ensure("then nothing", !tree.release(42));
+        ensure_equals("total back", tree.total_load(),
+                keys - load - flat.load(4));
+    }
+
+    template<>
+    template<>
+    void fixture::test<17>()
+    {
+        set_test_name("hash_n returns distinct successors");
+        algorithm::const_hash tree;
+        algorithm::const_hash flat(algorithm::const_hash::flat_layout);
+        algorithm::const_hash eytzinger(
+                algorithm::const_hash::eytzinger_layout);
+        int out[8];
+        ensure_equals("empty ring", flat.hash_n(uint64_t(1), 3, out), 0);
+
+        tree.add(0, 1000);
+        flat.add(0, 1000);
+        eytzinger.add(0, 1000);
+        ensure_equals("single node", flat.hash_n(uint64_t(1), 3, out), 1);
+        ensure_equals("single node owner", out[0], 0);
+
+        int nodes = random(2, 8);
+        for(int i = 1; i < nodes; ++i)
+        {
+            int weight = random(1, 5);
+            tree.add(i, weight);
+            flat.add(i, weight);
+            eytzinger.add(i, weight);
+        }
+
+        int loop = 2000;
+        for(int i = 0; i < loop; ++i)
+        {
+            uint64_t key = ((uint64_t)rand() << 32) | rand();
+            std::size_t k = random(1, 9);
+            int expected[8], flat_out[8], eytzinger_out[8];
+            std::size_t count = tree.hash_n(key, k, expected);
+            ensure_equals("count", count, std::min(k, (std::size_t)nodes));
+            ensure_equals("first is hash", expected[0], tree.hash_key(key));
+            ensure_equals("distinct",
+                    std::set<int>(expected, expected + count).size(), count);
+            ensure_equals("flat count", flat.hash_n(key, k, flat_out), count);
+            ensure_equals("eytzinger count",
+                    eytzinger.hash_n(key, k, eytzinger_out), count);
+            for(std::size_t j = 0; j < count; ++j)
+            {
+                ensure_equals("flat replica", flat_out[j], expected[j]);
+                ensure_equals("eytzinger replica", eytzinger_out[j],
+                        expected[j]);
+            }
+            ensure_equals("byte key replicas",
+                    flat.hash_n(&key, sizeof(key), k, flat_out),
+                    tree.hash_n(&key, sizeof(key), k, expected));
+            ensure_equals("byte key first replica", flat_out[0], expected[0]);
+        }
+    }
+
+    template<>
+    template<>
+    void fixture::test<18>()
+    {
+        set_test_name("batch apply");
+        algorithm::const_hash::layout_type layouts[] = {
+            algorithm::const_hash::tree_layout,
+            algorithm::const_hash::flat_layout,
+            algorithm::const_hash::eytzinger_layout
+        };
+        for(int l = 0; l < 3; ++l)
+        {
+            algorithm::const_hash one(layouts[l]), many(layouts[l]);
+            algorithm::const_hash::batch changes;
+            ensure("empty batch", changes.empty());
+            many.apply(changes);
+            ensure("nothing applied", many.empty());
+
+            for(int id = 0; id < 30; ++id)
+            {
+                one.add(id, 40);
+                changes.add(id, 40);
+            }
+            one.remove(4, 15);
+            changes.remove(4, 15);
+            one.erase(9);
+            changes.erase(9);
+            one.add(9, 10);
+            changes.add(9, 10);
+            one.remove(12, 100);
+            changes.remove(12, 100);
+            changes.erase(1000);
+            ensure_equals("operations", changes.size(), 35u);
+            many.apply(changes);
+
+            ensure("alive_set", many.alive_set() == one.alive_set());
+            ensure_equals("size", many.size(), one.size());
+            ensure("ring", std::equal(one.begin(), one.end(), many.begin()));
+            for(int id = 0; id < 30; ++id)
+            {
+                ensure_equals("weight", many.weight(id), one.weight(id));
+            }
+            for(int i = 0; i < 2000; ++i)
+            {
+                uint64_t key = ((uint64_t)rand() << 32) | rand();
+                ensure_equals("owner", many.hash_key(key), one.hash_key(key));
+            }
+
+            changes.clear();
+            ensure("cleared", changes.empty());
+            changes.add(100, 1);
+            changes.add(101, algorithm::const_hash::MAX_NODES);
+            ensure_THROW(many.apply(changes), std::range_error);
+            ensure_equals("unchanged", many.weight(100), 0);
+            ensure_equals("unchanged size", many.size(), one.size());
+        }
+    }
+
+    template<>
+    template<>
+    void fixture::test<19>()
+    {
+        set_test_name("basic_const_hash matches const_hash");
+        algorithm::basic_const_hash<> tree,
+            flat(algorithm::basic_const_hash<>::flat_layout);
+        algorithm::const_hash hash;
+        int nodes = random(2, 20);
+        for(int i = 0; i < nodes; ++i)
+        {
+            int weight = random(1, 100);
+            tree.add(i, weight);
+            flat.add(i, weight);
+            hash.add(i, weight);
+        }
+        tree.erase(1);
+        flat.erase(1);
+        hash.erase(1);
+
+        ensure_equals("size", tree.size(), hash.size());
+        ensure("ring", std::equal(hash.begin(), hash.end(), tree.begin()));
+        ensure("alive_set", tree.alive_set() == hash.alive_set());
+        for(int i = 0; i < 2000; ++i)
+        {
+            uint64_t key = ((uint64_t)rand() << 32) | rand();
+            double r = random();
+            ensure_equals("key", tree.hash_key(key), hash.hash_key(key));
+            ensure_equals("flat key", flat.hash_key(key), hash.hash_key(key));
+            ensure_equals("resource", tree.hash(r), hash.hash(r));
+        }
+    }
+
+    template<>
+    template<>
+    void fixture::test<20>()
+    {
+        set_test_name("64-bit points and ids");
+        typedef algorithm::basic_const_hash<uint64_t, uint64_t,
+                algorithm::key_hash_generator> wide_hash;
+        ensure_equals("point bits", (int)wide_hash::POINT_BITS, 63);
+
+        wide_hash tree, flat(wide_hash::flat_layout);
+        const uint64_t base = 0x100000000ull;
+        for(uint64_t id = base; id < base + 10; ++id)
+        {
+            tree.add(id, 50);
+            flat.add(id, 50);
+        }
+        flat.bucket_bits(12);
+        ensure_equals("size", tree.size(), 500u);
+        ensure_equals("weight", tree.weight(base + 3), 50);
+        ensure_equals("remove", tree.remove(base + 3, 20), 30);
+        flat.remove(base + 3, 20);
+        for(wide_hash::const_iterator it = tree.begin(); it != tree.end();
+                ++it)
+        {
+            ensure("point range", it->first <= wide_hash::MAX_POINT);
+        }
+
+        for(int i = 0; i < 2000; ++i)
+        {
+            uint64_t key = ((uint64_t)rand() << 32) | rand();
+            uint64_t owner = tree.hash_key(key);
+            ensure("owner", owner >= base && owner < base + 10);
+            ensure_equals("flat owner", flat.hash_key(key), owner);
+            uint64_t replicas[3];
+            ensure_equals("replicas", tree.hash_n(key, 3, replicas), 3u);
+            ensure_equals("first replica", replicas[0], owner);
+        }
+        for(double r = 0; r <= 1; r += 0.01)
+        {
+            ensure_equals("resource", flat.hash(r), tree.hash(r));
+        }
+        ensure_equals("last point", tree.hash(1.0), tree.hash(0.0));
+        ensure_THROW(tree.hash(2), std::range_error);
+    }
+
+    template<>
+    template<>
+    void fixture::test<21>()
+    {
+        set_test_name("compact layout");
+        algorithm::const_hash tree,
+            compact(algorithm::const_hash::compact_layout);
+        ensure_equals("empty bytes", compact.lookup_bytes(), 0u);
+        int nodes = random(2, 40);
+        for(int i = 0; i < nodes; ++i)
+        {
+            int weight = random(1, 200);
+            tree.add(i * 1000, weight);
+            compact.add(i * 1000, weight);
+        }
+        compact.remove(0, 5);
+        tree.remove(0, 5);
+
+        for(int i = 0; i < 5000; ++i)
+        {
+            uint64_t key = ((uint64_t)rand() << 32) | rand();
+            ensure_equals("owner", compact.hash_key(key), tree.hash_key(key));
+            // fewer than 3 nodes may be left, node 0 among the leavers.
+            int expected[3], out[3];
+            std::size_t count = tree.hash_n(key, 3, expected);
+            ensure_equals("replicas", compact.hash_n(key, 3, out), count);
+            for(std::size_t r = 0; r < count; ++r)
+            {
+                ensure_equals("replica", out[r], expected[r]);
+            }
+        }
+        ensure("six bytes a point and the id table",
+                compact.lookup_bytes() == compact.size() * 6
+                + compact.alive().size() * sizeof(int));
+        ensure("smaller than flat", compact.bytes_per_point() < 8);
+        ensure("tree estimate", tree.bytes_per_point() >= 32);
+
+        // one rebuild for the whole table of nodes.
+        algorithm::const_hash full(algorithm::const_hash::compact_layout);
+        algorithm::const_hash::batch changes;
+        for(int i = 0; i < 65536; ++i)
+        {
+            changes.add(i, 1);
+        }
+        full.apply(changes);
+        ensure_THROW(full.add(65536, 1), std::range_error);
+        ensure_equals("not added", full.weight(65536), 0);
+        full.add(7, 1);
+        ensure_equals("existing node grows", full.weight(7), 2);
+        changes.clear();
+        changes.erase(3);
+        changes.add(70000, 1);
+        ensure_THROW(full.apply(changes), std::range_error);
+        ensure_equals("batch not applied", full.weight(3), 1);
+    }
+
+    template<>
+    template<>
+    void fixture::test<22>()
+    {
+        set_test_name("alive view");
+        algorithm::const_hash hash;
+        algorithm::alive_view<int> view = hash.alive();
+        ensure("empty view", view.empty());
+        ensure_equals("empty size", view.size(), 0u);
+        ensure("nothing alive", !view.contains(0));
+
+        std::set<int> expected;
+        for(int i = 0; i < 200; ++i)
+        {
+            int id = random(-1000, 1000);
+            int weight = random(0, 5);
+            hash.add(id, weight);
+            if(weight > 0)
+            {
+                expected.insert(id);
+            }
+            if(i % 7 == 0 && !expected.empty())
+            {
+                int gone = *expected.begin();
+                hash.erase(gone);
+                expected.erase(gone);
+            }
+            if(i % 11 == 0 && !expected.empty())
+            {
+                int smaller = *expected.rbegin();
+                if(hash.remove(smaller, 2) == 0)
+                {
+                    expected.erase(smaller);
+                }
+            }
+
+            view = hash.alive();
+            ensure_equals("size", view.size(), expected.size());
+            ensure("sorted ids", std::equal(expected.begin(), expected.end(),
+                        view.begin()));
+            ensure("alive_set", hash.alive_set() == expected);
+            for(std::set<int>::const_iterator it = expected.begin();
+                    it != expected.end(); ++it)
+            {
+                ensure("contains", view.contains(*it));
+            }
+            ensure("not contains", !view.contains(2000));
+        }
+        if(!view.empty())
+        {
+            ensure_equals("index", view[0], *expected.begin());
+        }
+    }
+
+    template<>
+    template<>
+    void fixture::test<23>()
+    {
+        set_test_name("integral keys");
+        algorithm::const_hash hash;
+        for(int i = 0; i < 10; ++i)
+        {
+            hash.add(i, 50);
+        }
+        int owner = hash.hash_key(uint64_t(42));
+        ensure_equals("int", hash.hash_key(42), owner);
+        ensure_equals("unsigned", hash.hash_key(42u), owner);
+        ensure_equals("long", hash.hash_key(42L), owner);
+        ensure_equals("size_t", hash.hash_key((std::size_t)42), owner);
+        ensure_equals("position", hash.hash(0.5), hash.hash(0.5f));
+        ensure_THROW(hash.hash(42), std::range_error);
+    }
+}
@@ -0,0 +1,120 @@
+#include "algorithm/jumphash.hpp"
+#include "tut/tut.hpp"
+#include "tut/tut_macros.hpp"
+#include <cstdlib>
+#include <vector>
+
+namespace
+{
+    struct data
+    {
+        int random (int a, int b)
+        {
+            if (b < a)
+            {
+                throw std::invalid_argument("b is less than a");
+            }
+            if(b == a)
+            {
+                return a;
+            }
+            double r = rand();
+            return (int)(r / RAND_MAX * (b-a) + a);
+        }
+
+        uint64_t key()
+        {
+            return ((uint64_t)rand() << 32) | rand();
+        }
+    };
+    typedef tut::test_group<data> group;
+    group g("jump_hash");
+
+    typedef group::object fixture;
+}
+
+namespace tut
+{
+    template<>
+    template<>
+    void fixture::test<1>()
+    {
+        set_test_name("construct object");
+        algorithm::jump_hash hash;
+        ensure("default hash empty", hash.empty());
+        ensure("default alive_set empty", hash.alive_set().empty());
+        ensure_THROW(hash.hash(0.5), std::domain_error);
+        ensure_THROW(hash.hash_key(uint64_t(1)), std::domain_error);
+        ensure_THROW(hash.pop_back(), std::domain_error);
+    }
+
+    template<>
+    template<>
+    void fixture::test<2>()
+    {
+        set_test_name("push and pop nodes");
+        algorithm::jump_hash hash;
+        hash.push_back(7);
+        ensure_not("hash not empty", hash.empty());
+        ensure_equals("one node", hash.size(), 1);
+        ensure_equals("alive_set has node 7", hash.alive_set().count(7), 1);
+        ensure_THROW(hash.push_back(7), std::invalid_argument);
+        for(int i = 0; i < 100; ++i)
+        {
+            ensure_equals("single node owner", hash.hash_key(key()), 7);
+        }
+        ensure_THROW(hash.hash(2), std::range_error);
+
+        hash.push_back(3);
+        ensure_equals("two nodes", hash.size(), 2);
+        ensure_equals("pop last node", hash.pop_back(), 3);
+        ensure_equals("alive_set has no node 3", hash.alive_set().count(3), 0);
+        ensure_equals("pop first node", hash.pop_back(), 7);
+        ensure("hash empty", hash.empty());
+    }
+
+    template<>
+    template<>
+    void fixture::test<3>()
+    {
+        set_test_name("keys only move to the new bucket");
+        algorithm::jump_hash hash;
+        int nodes = random(1, 100);
+        for(int i = 0; i < nodes; ++i)
+        {
+            hash.push_back(i * 10);
+        }
+
+        std::vector<uint64_t> keys(10000);
+        std::vector<int> owners(keys.size());
+        for(size_t i = 0; i < keys.size(); ++i)
+        {
+            keys[i] = key();
+            owners[i] = hash.hash_key(keys[i]);
+            ensure("owner alive", hash.alive_set().count(owners[i]) == 1);
+        }
+
+        hash.push_back(-1);
+        int moved = 0;
+        for(size_t i = 0; i < keys.size(); ++i)
+        {
+            int owner = hash.hash_key(keys[i]);
+            if(owner != owners[i])
+            {
+                ensure_equals("moved to new node", owner, -1);
+                ++moved;
+            }
+        }
+        double expected = (double)keys.size() / (nodes + 1);
+        ensure("new node share", moved > expected / 2 && moved < expected * 2);
+
+        hash.pop_back();
+        for(size_t i = 0; i < keys.size(); ++i)
+        {
+            ensure_equals("owner restored", hash.hash_key(keys[i]), owners[i]);
+            ensure_equals("byte key deterministic",
+                    hash.hash_key(&keys[i], sizeof(keys[i])),
+                    hash.hash_key(&keys[i], sizeof(keys[i])));
+        }
+    }
+}
@@ -0,0 +1,141 @@
+#include "algorithm/maglevhash.hpp"
+#include "tut/tut.hpp"
+#include "tut/tut_macros.hpp"
+#include <cstdlib>
+#include <map>
+#include <vector>
+
+namespace
+{
+    struct data
+    {
+        uint64_t key()
+        {
+            return ((uint64_t)rand() << 32) | rand();
+        }
+    };
+    typedef tut::test_group<data> group;
+    group g("maglev_hash");
+
+    typedef group::object fixture;
+}
+
+namespace tut
+{
+    template<>
+    template<>
+    void fixture::test<1>()
+    {
+        set_test_name("construct object");
+        algorithm::maglev_hash hash;
+        ensure("default hash empty", hash.empty());
+        ensure("default alive_set empty", hash.alive_set().empty());
+        ensure_equals("default table size", hash.size(), 65537);
+        ensure_equals("default weight", hash.weight(1), 0);
+        ensure_THROW(hash.hash(0.5), std::domain_error);
+        ensure_THROW(algorithm::maglev_hash(100), std::invalid_argument);
+    }
+
+    template<>
+    template<>
+    void fixture::test<2>()
+    {
+        set_test_name("add and erase nodes");
+        algorithm::maglev_hash hash(251);
+        hash.add(4, 1);
+        ensure_not("hash not empty", hash.empty());
+        ensure_equals("alive_set has node 4", hash.alive_set().count(4), 1);
+        ensure_equals("table bytes", hash.table_bytes(), 251 * sizeof(int));
+        for(int i = 0; i < 100; ++i)
+        {
+            ensure_equals("single node owner", hash.hash_key(key()), 4);
+        }
+        ensure_THROW(hash.hash(2), std::range_error);
+
+        hash.add(5, 2);
+        hash.add(5, 1);
+        ensure_equals("node 5 weight", hash.weight(5), 3);
+        ensure_equals("two nodes", hash.alive_set().size(), 2);
+        hash.erase(4);
+        hash.erase(6);
+        ensure_equals("one node", hash.alive_set().size(), 1);
+        ensure_equals("node 4 weight", hash.weight(4), 0);
+        for(int i = 0; i < 100; ++i)
+        {
+            ensure_equals("remaining node owner", hash.hash_key(key()), 5);
+        }
+        hash.erase(5);
+        ensure("hash empty", hash.empty());
+    }
+
+    template<>
+    template<>
+    void fixture::test<3>()
+    {
+        set_test_name("weighted nodes share the table");
+        algorithm::maglev_hash hash;
+        hash.add(0, 1);
+        hash.add(1, 1);
+        hash.add(2, 2);
+        std::map<int, int> count;
+        int loop = 100000;
+        for(int i = 0; i < loop; ++i)
+        {
+            ++count[hash.hash_key(key())];
+        }
+        ensure("node 0 share", count[0] > loop / 4 * 0.9
+                && count[0] < loop / 4 * 1.1);
+        ensure("node 1 share", count[1] > loop / 4 * 0.9
+                && count[1] < loop / 4 * 1.1);
+        ensure("node 2 share", count[2] > loop / 2 * 0.9
+                && count[2] < loop / 2 * 1.1);
+    }
+
+    template<>
+    template<>
+    void fixture::test<4>()
+    {
+        set_test_name("removing a node moves few other keys");
+        algorithm::maglev_hash hash;
+        int nodes = 20;
+        for(int i = 0; i < nodes; ++i)
+        {
+            hash.add(i, 1);
+        }
+
+        std::vector<uint64_t> keys(100000);
+        std::vector<int> owners(keys.size());
+        for(size_t i = 0; i < keys.size(); ++i)
+        {
+            keys[i] = key();
+            owners[i] = hash.hash_key(keys[i]);
+        }
+
+        hash.erase(7);
+        int moved = 0, orphaned = 0;
+        for(size_t i = 0; i < keys.size(); ++i)
+        {
+            int owner = hash.hash_key(keys[i]);
+            ensure("not on removed node", owner != 7);
+            if(owners[i] == 7)
+            {
+                ++orphaned;
+            }
+            else if(owner != owners[i])
+            {
+                ++moved;
+            }
+        }
+        double disruption = (double)(moved + orphaned) / keys.size();
+        double extra = (double)moved / keys.size();
+        ensure("disruption close to 1/n",
+                disruption < 1.0 / nodes + 0.02);
+        ensure("few keys of other nodes move", extra < 0.02);
+
+        hash.add(7, 1);
+        for(size_t i = 0; i < keys.size(); ++i)
+        {
+            ensure_equals("owner restored", hash.hash_key(keys[i]), owners[i]);
+        }
+    }
+}
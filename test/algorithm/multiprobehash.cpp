@@ -0,0 +1,153 @@
+#include "algorithm/multiprobehash.hpp"
+#include "tut/tut.hpp"
+#include "tut/tut_macros.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace
+{
+    struct data
+    {
+        uint64_t key()
+        {
+            return ((uint64_t)rand() << 32) | rand();
+        }
+
+        // highest node load over the average load.
+        double peak(const algorithm::multiprobe_hash& hash, int keys)
+        {
+            std::map<int, int> count;
+            int highest = 0;
+            for(int i = 0; i < keys; ++i)
+            {
+                highest = std::max(highest, ++count[hash.hash_key(key())]);
+            }
+            return highest / ((double)keys / hash.size());
+        }
+    };
+    typedef tut::test_group<data> group;
+    group g("multiprobe_hash");
+
+    typedef group::object fixture;
+}
+
+namespace tut
+{
+    template<>
+    template<>
+    void fixture::test<1>()
+    {
+        set_test_name("construct object");
+        algorithm::multiprobe_hash hash;
+        ensure("default hash empty", hash.empty());
+        ensure("default alive_set empty", hash.alive_set().empty());
+        ensure_equals("default probes", hash.probes(), 21);
+        ensure_THROW(hash.hash(0.5), std::domain_error);
+        ensure_THROW(hash.probes(0), std::range_error);
+        ensure_THROW(algorithm::multiprobe_hash(257), std::range_error);
+    }
+
+    template<>
+    template<>
+    void fixture::test<2>()
+    {
+        set_test_name("one point per node");
+        algorithm::multiprobe_hash hash;
+        hash.add(3);
+        hash.add(3);
+        ensure_equals("one point", hash.size(), 1);
+        ensure_equals("alive_set has node 3", hash.alive_set().count(3), 1);
+        for(int i = 0; i < 100; ++i)
+        {
+            ensure_equals("single node owner", hash.hash_key(key()), 3);
+        }
+        ensure_THROW(hash.hash(2), std::range_error);
+        for(int i = 0; i < 100; ++i)
+        {
+            hash.add(i);
+        }
+        ensure_equals("one point each", hash.size(), 100);
+        hash.erase(3);
+        hash.erase(3);
+        ensure_equals("point erased", hash.size(), 99);
+        ensure_equals("node 3 gone", hash.alive_set().count(3), 0);
+    }
+
+    template<>
+    template<>
+    void fixture::test<3>()
+    {
+        set_test_name("keys only move to or from the changed node");
+        algorithm::multiprobe_hash hash;
+        for(int i = 0; i < 50; ++i)
+        {
+            hash.add(i);
+        }
+        std::vector<uint64_t> keys(20000);
+        std::vector<int> owners(keys.size());
+        for(size_t i = 0; i < keys.size(); ++i)
+        {
+            keys[i] = key();
+            owners[i] = hash.hash_key(keys[i]);
+        }
+
+        hash.add(1000);
+        for(size_t i = 0; i < keys.size(); ++i)
+        {
+            int owner = hash.hash_key(keys[i]);
+            ensure("moved to new node", owner == owners[i] || owner == 1000);
+        }
+        hash.erase(1000);
+        hash.erase(7);
+        for(size_t i = 0; i < keys.size(); ++i)
+        {
+            if(owners[i] != 7)
+            {
+                ensure_equals("owner kept", hash.hash_key(keys[i]), owners[i]);
+            }
+        }
+    }
+
+    template<>
+    template<>
+    void fixture::test<4>()
+    {
+        set_test_name("more probes balance better");
+        algorithm::multiprobe_hash hash(1);
+        for(int i = 0; i < 100; ++i)
+        {
+            hash.add(i);
+        }
+        double single = peak(hash, 200000);
+        hash.probes(21);
+        double many = peak(hash, 200000);
+        ensure("21 probes balance", many < 1.3);
+        ensure("21 probes beat one", many < single);
+    }
+
+    template<>
+    template<>
+    void fixture::test<5>()
+    {
+        set_test_name("byte keys");
+        algorithm::multiprobe_hash hash;
+        for(int i = 0; i < 20; ++i)
+        {
+            hash.add(i);
+        }
+        for(int i = 0; i < 1000; ++i)
+        {
+            uint64_t k = key();
+            ensure_equals("byte key owner", hash.hash_key(&k, sizeof(k)),
+                    hash.hash_key(algorithm::key_hash(&k, sizeof(k))));
+        }
+        std::string text = "resource";
+        int owner = hash.hash_key(text.data(), text.size());
+        ensure("known owner", hash.alive_set().count(owner) == 1);
+        ensure_equals("stable owner",
+                hash.hash_key(text.data(), text.size()), owner);
+    }
+}
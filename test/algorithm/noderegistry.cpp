@@ -0,0 +1,150 @@
+#include "algorithm/noderegistry.hpp"
+#include "tut/tut.hpp"
+#include "tut/tut_macros.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+namespace
+{
+    struct data
+    {
+        uint64_t key()
+        {
+            return ((uint64_t)rand() << 32) | rand();
+        }
+
+        std::string address(int i)
+        {
+            char buffer[32];
+            std::sprintf(buffer, "10.0.0.%d:%d", i, 8000 + i);
+            return buffer;
+        }
+    };
+    typedef tut::test_group<data> group;
+    group g("node_registry");
+
+    typedef group::object fixture;
+}
+
+namespace tut
+{
+    template<>
+    template<>
+    void fixture::test<1>()
+    {
+        set_test_name("dense indices");
+        algorithm::node_registry<std::string> registry;
+        ensure("empty", registry.empty());
+        ensure_equals("first", registry.intern("a:1"), 0);
+        ensure_equals("second", registry.intern("b:2"), 1);
+        ensure_equals("again", registry.intern("a:1"), 0);
+        ensure_equals("size", registry.size(), 2u);
+        ensure_equals("find", registry.find("b:2"), 1);
+        ensure_equals("missing", registry.find("c:3"), -1);
+        ensure_equals("descriptor", registry[1], std::string("b:2"));
+
+        registry.release(0);
+        registry.release(0);
+        ensure_equals("released", registry.find("a:1"), -1);
+        ensure_equals("size after release", registry.size(), 1u);
+        ensure_equals("reused", registry.intern("c:3"), 0);
+        ensure_equals("reused descriptor", registry[0], std::string("c:3"));
+    }
+
+    template<>
+    template<>
+    void fixture::test<2>()
+    {
+        set_test_name("descriptor lookups");
+        algorithm::registry_hash<std::string> hash;
+        ensure("empty", hash.empty());
+        ensure_THROW(hash.hash_key(uint64_t(1)), std::domain_error);
+
+        for(int i = 0; i < 10; ++i)
+        {
+            hash.add(address(i), 100);
+        }
+        hash.add(address(3), 0);
+        ensure_equals("weight", hash.weight(address(3)), 100);
+        ensure_equals("remove", hash.remove(address(3), 40), 60);
+        hash.erase(address(5));
+        ensure_equals("erased", hash.weight(address(5)), 0);
+        ensure_equals("alive", hash.alive_set().size(), 9u);
+        ensure_equals("registry follows", hash.registry().size(), 9u);
+
+        for(int i = 0; i < 5000; ++i)
+        {
+            uint64_t k = key();
+            const std::string& node = hash.hash_key(k);
+            int index = hash.points().hash_key(k);
+            ensure("interned reference", &node == &hash.registry()[index]);
+            ensure("alive", hash.alive_set().count(node) == 1);
+
+            const std::string* replicas[3];
+            ensure_equals("replicas", hash.hash_n(k, 3, replicas), 3u);
+            ensure("first replica", replicas[0] == &node);
+        }
+        ensure_THROW(hash.hash(2), std::range_error);
+    }
+
+    template<>
+    template<>
+    void fixture::test<3>()
+    {
+        set_test_name("placement ignores intern order");
+        algorithm::registry_hash<std::string> forward, backward;
+        for(int i = 0; i < 20; ++i)
+        {
+            forward.add(address(i), 50);
+            backward.add(address(19 - i), 50);
+        }
+        // a released index is reused by an unrelated node.
+        forward.add("spare", 10);
+        forward.erase("spare");
+        forward.erase(address(0));
+        backward.erase(address(0));
+        forward.add(address(0), 50);
+        backward.add(address(0), 50);
+
+        for(int i = 0; i < 5000; ++i)
+        {
+            uint64_t k = key();
+            ensure_equals("same node", forward.hash_key(k), backward.hash_key(k));
+        }
+
+        algorithm::registry_hash<long long> numbers(
+                algorithm::registry_hash<long long>::ring_type::flat_layout);
+        numbers.add(1ll << 40, 30);
+        numbers.add(7, 30);
+        long long owner = numbers.hash(0.5);
+        ensure("integral descriptors", owner == 7 || owner == (1ll << 40));
+    }
+
+    template<>
+    template<>
+    void fixture::test<4>()
+    {
+        set_test_name("references survive other nodes");
+        algorithm::registry_hash<std::string> hash;
+        hash.add(address(0), 20);
+        const std::string& first = hash.hash(0.5);
+        const std::string* pointer = &first;
+        const std::string* replicas[1];
+        ensure_equals("replica", hash.hash_n(1, 1, replicas), 1u);
+
+        // enough nodes to have grown any contiguous storage many times.
+        for(int i = 1; i < 2000; ++i)
+        {
+            hash.add(address(i), 2);
+        }
+        for(int i = 1; i < 2000; i += 2)
+        {
+            hash.erase(address(i));
+        }
+        int index = hash.registry().find(address(0));
+        ensure("not moved", &hash.registry()[index] == pointer);
+        ensure("replica not moved", replicas[0] == pointer);
+        ensure_equals("same descriptor", first, address(0));
+    }
+}
@@ -0,0 +1,188 @@
+#include "algorithm/rendezvoushash.hpp"
+#include "tut/tut.hpp"
+#include "tut/tut_macros.hpp"
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <set>
+#include <vector>
+
+namespace
+{
+    struct data
+    {
+        uint64_t key()
+        {
+            return ((uint64_t)rand() << 32) | rand();
+        }
+    };
+    typedef tut::test_group<data> group;
+    group g("rendezvous_hash");
+
+    typedef group::object fixture;
+}
+
+namespace tut
+{
+    template<>
+    template<>
+    void fixture::test<1>()
+    {
+        set_test_name("construct object");
+        algorithm::rendezvous_hash hash;
+        ensure("default hash empty", hash.empty());
+        ensure("default alive_set empty", hash.alive_set().empty());
+        ensure_equals("default weight", hash.weight(1), 0.0);
+        ensure_THROW(hash.hash(0.5), std::domain_error);
+        int out;
+        ensure_equals("empty top", hash.top(1, 1, &out), 0);
+        ensure_THROW(hash.add(1, 0), std::invalid_argument);
+    }
+
+    template<>
+    template<>
+    void fixture::test<2>()
+    {
+        set_test_name("kernels match scalar scores");
+        std::vector<uint32_t> seeds(64);
+        std::vector<float> inv_weights(64);
+        for(size_t i = 0; i < seeds.size(); ++i)
+        {
+            seeds[i] = (uint32_t)key();
+            inv_weights[i] = 1.0f / (1 + rand() % 100);
+        }
+        std::vector<float> expected(64), scores(64);
+        for(int loop = 0; loop < 10000; ++loop)
+        {
+            uint32_t k = (uint32_t)key();
+            algorithm::rendezvous_score::scores_scalar(k, &seeds[0],
+                    &inv_weights[0], seeds.size(), &expected[0]);
+            algorithm::rendezvous_score::scores(k, &seeds[0],
+                    &inv_weights[0], seeds.size(), &scores[0]);
+            for(size_t i = 0; i < seeds.size(); ++i)
+            {
+                ensure("score positive", expected[i] > 0);
+                ensure_equals("dispatched score", scores[i], expected[i]);
+            }
+#ifdef RENDEZVOUS_SCORE_X86
+            if(__builtin_cpu_supports("avx2"))
+            {
+                algorithm::rendezvous_score::scores_avx2(k, &seeds[0],
+                        &inv_weights[0], seeds.size(), &scores[0]);
+                for(size_t i = 0; i < seeds.size(); ++i)
+                {
+                    ensure_equals("avx2 score", scores[i], expected[i]);
+                }
+            }
+#endif
+        }
+    }
+
+    template<>
+    template<>
+    void fixture::test<3>()
+    {
+        set_test_name("weighted shares and minimal disruption");
+        algorithm::rendezvous_hash hash;
+        for(int i = 0; i < 9; ++i)
+        {
+            hash.add(i, 1);
+        }
+        hash.add(9, 3);
+        ensure_equals("node 9 weight", hash.weight(9), 3.0);
+        ensure_equals("ten nodes", hash.alive_set().size(), 10);
+
+        std::vector<uint64_t> keys(100000);
+        std::vector<int> owners(keys.size());
+        std::map<int, int> count;
+        for(size_t i = 0; i < keys.size(); ++i)
+        {
+            keys[i] = key();
+            owners[i] = hash.hash_key(keys[i]);
+            ++count[owners[i]];
+        }
+        double share = (double)count[9] / keys.size();
+        ensure("heavy node share", share > 0.25 * 0.9 && share < 0.25 * 1.1);
+        share = (double)count[0] / keys.size();
+        ensure("light node share",
+                share > 0.75 / 9 * 0.9 && share < 0.75 / 9 * 1.1);
+
+        hash.erase(4);
+        ensure_equals("nine nodes", hash.alive_set().size(), 9);
+        for(size_t i = 0; i < keys.size(); ++i)
+        {
+            if(owners[i] != 4)
+            {
+                ensure_equals("owner kept", hash.hash_key(keys[i]), owners[i]);
+            }
+        }
+        hash.add(4, 1);
+        for(size_t i = 0; i < keys.size(); ++i)
+        {
+            ensure_equals("owner restored", hash.hash_key(keys[i]), owners[i]);
+        }
+    }
+
+    template<>
+    template<>
+    void fixture::test<4>()
+    {
+        set_test_name("top k replicas");
+        algorithm::rendezvous_hash hash;
+        int nodes = 1 + rand() % 64;
+        for(int i = 0; i < nodes; ++i)
+        {
+            hash.add(i * 3, 1 + rand() % 4);
+        }
+        int out[80];
+        for(int loop = 0; loop < 1000; ++loop)
+        {
+            uint64_t k = key();
+            size_t count = hash.top(k, 80, out);
+            ensure_equals("all nodes ranked", count, (size_t)nodes);
+            ensure_equals("best is hash", out[0], hash.hash_key(k));
+            ensure_equals("distinct", std::set<int>(out, out + count).size(),
+                    count);
+
+            int first[3];
+            size_t n = hash.top(k, 3, first);
+            ensure_equals("top 3 count", n, std::min((size_t)3, count));
+            for(size_t i = 0; i < n; ++i)
+            {
+                ensure_equals("top 3 prefix", first[i], out[i]);
+            }
+
+            hash.erase(out[0]);
+            if(!hash.empty())
+            {
+                ensure_equals("next best takes over", hash.hash_key(k), out[1]);
+            }
+            hash.add(out[0], 1);
+            hash.erase(out[0]);
+            hash.add(out[0], 1);
+        }
+    }
+
+    template<>
+    template<>
+    void fixture::test<5>()
+    {
+        set_test_name("byte keys");
+        algorithm::rendezvous_hash hash;
+        for(int i = 0; i < 20; ++i)
+        {
+            hash.add(i, 1 + i % 3);
+        }
+        for(int i = 0; i < 1000; ++i)
+        {
+            uint64_t k = key();
+            ensure_equals("byte key owner", hash.hash_key(&k, sizeof(k)),
+                    hash.hash_key(algorithm::key_hash(&k, sizeof(k))));
+        }
+        std::string text = "resource";
+        int owner = hash.hash_key(text.data(), text.size());
+        ensure("known owner", hash.alive_set().count(owner) == 1);
+        ensure_equals("stable owner",
+                hash.hash_key(text.data(), text.size()), owner);
+    }
+}
@@ -0,0 +1,153 @@
+#include "algorithm/ringdiff.hpp"
+#include "tut/tut.hpp"
+#include "tut/tut_macros.hpp"
+#include <cstdlib>
+
+namespace
+{
+    struct data
+    {
+        uint64_t key()
+        {
+            return ((uint64_t)rand() << 32) | rand();
+        }
+
+        // the arc holding point p, NULL if p keeps its owner.
+        const algorithm::ring_diff::arc* find(
+                const algorithm::ring_diff& diff,
+                algorithm::ring_diff::point_type p)
+        {
+            for(algorithm::ring_diff::const_iterator it = diff.begin();
+                    it != diff.end(); ++it)
+            {
+                if(it->first <= p && p <= it->last)
+                {
+                    return &*it;
+                }
+            }
+            return NULL;
+        }
+    };
+    typedef tut::test_group<data> group;
+    group g("ring_diff");
+
+    typedef group::object fixture;
+}
+
+namespace tut
+{
+    template<>
+    template<>
+    void fixture::test<1>()
+    {
+        set_test_name("same ring");
+        algorithm::const_hash before, after;
+        ensure_THROW(algorithm::ring_diff(before, after), std::domain_error);
+        for(int id = 0; id < 10; ++id)
+        {
+            before.add(id, 20);
+            after.add(id, 20);
+        }
+        algorithm::ring_diff diff(before, after);
+        ensure("no arcs", diff.empty());
+        ensure_equals("nothing moved", diff.moved(), 0u);
+        ensure_equals("nothing sent", diff.sent(3), 0u);
+    }
+
+    template<>
+    template<>
+    void fixture::test<2>()
+    {
+        set_test_name("added node");
+        algorithm::const_hash before, after;
+        for(int id = 0; id < 10; ++id)
+        {
+            before.add(id, 50);
+            after.add(id, 50);
+        }
+        after.add(10, 50);
+        algorithm::ring_diff diff(before, after);
+
+        for(algorithm::ring_diff::const_iterator it = diff.begin();
+                it != diff.end(); ++it)
+        {
+            ensure_equals("to new node", it->to, 10);
+            ensure("arc order", it->first <= it->last);
+        }
+        uint64_t sent = 0;
+        for(int id = 0; id < 10; ++id)
+        {
+            sent += diff.sent(id);
+        }
+        ensure_equals("sent", sent, diff.moved());
+        ensure_equals("received", diff.received(10), diff.moved());
+        ensure("about one in eleven moves",
+                diff.fraction() > 0.05 && diff.fraction() < 0.15);
+    }
+
+    template<>
+    template<>
+    void fixture::test<3>()
+    {
+        set_test_name("arcs match lookups");
+        algorithm::const_hash before, after;
+        for(int id = 0; id < 8; ++id)
+        {
+            before.add(id, 30);
+            after.add(id, 30);
+        }
+        after.erase(2);
+        after.remove(5, 10);
+        after.add(8, 40);
+        algorithm::ring_diff diff(before, after);
+
+        for(algorithm::ring_diff::const_iterator it = diff.begin();
+                it != diff.end(); ++it)
+        {
+            ensure("owners differ", it->from != it->to);
+            if(it + 1 != diff.end())
+            {
+                ensure("sorted", it->last < (it + 1)->first);
+            }
+        }
+        uint64_t sent = 0, received = 0;
+        for(int id = 0; id <= 8; ++id)
+        {
+            sent += diff.sent(id);
+            received += diff.received(id);
+        }
+        ensure_equals("sent", sent, diff.moved());
+        ensure_equals("received", received, diff.moved());
+        ensure_equals("erased node receives nothing", diff.received(2), 0u);
+        ensure_equals("new node sends nothing", diff.sent(8), 0u);
+
+        for(int i = 0; i < 20000; ++i)
+        {
+            uint64_t k = key();
+            algorithm::const_hash::point_type p =
+                algorithm::const_hash::point(k);
+            const algorithm::ring_diff::arc* moving = find(diff, p);
+            if(before.hash_key(k) == after.hash_key(k))
+            {
+                ensure("stays", moving == NULL);
+            }
+            else
+            {
+                ensure("moves", moving != NULL);
+                ensure_equals("from", moving->from, before.hash_key(k));
+                ensure_equals("to", moving->to, after.hash_key(k));
+            }
+        }
+
+        // the ends of the key space, around the wrap.
+        const algorithm::const_hash::point_type ends[] = {0,
+            algorithm::const_hash::MAX_NODES};
+        for(int i = 0; i < 2; ++i)
+        {
+            const algorithm::ring_diff::arc* moving = find(diff, ends[i]);
+            double r = (double)ends[i] / algorithm::const_hash::MAX_NODES;
+            ensure_equals("end", moving != NULL,
+                    before.hash(r) != after.hash(r));
+        }
+    }
+}
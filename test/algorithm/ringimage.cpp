@@ -0,0 +1,200 @@
+#include "algorithm/ringimage.hpp"
+#include "tut/tut.hpp"
+#include "tut/tut_macros.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <dirent.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace
+{
+    struct data
+    {
+        data()
+        {
+            char name[] = "/tmp/ringimageXXXXXX";
+            int fd = mkstemp(name);
+            close(fd);
+            path = name;
+        }
+
+        ~data()
+        {
+            std::remove(path.c_str());
+        }
+
+        uint64_t key()
+        {
+            return ((uint64_t)rand() << 32) | rand();
+        }
+
+        // overwrites one byte of the image at offset.
+        void corrupt(long offset)
+        {
+            std::FILE* file = std::fopen(path.c_str(), "r+b");
+            std::fseek(file, offset, SEEK_SET);
+            int c = std::fgetc(file);
+            std::fseek(file, offset, SEEK_SET);
+            std::fputc(c ^ 0xFF, file);
+            std::fclose(file);
+        }
+
+        std::string path;
+    };
+    typedef tut::test_group<data> group;
+    group g("ring_image");
+
+    typedef group::object fixture;
+}
+
+namespace tut
+{
+    template<>
+    template<>
+    void fixture::test<1>()
+    {
+        set_test_name("empty image");
+        algorithm::const_hash hash;
+        algorithm::ring_image::save(hash, path.c_str());
+        algorithm::ring_image image(path.c_str());
+        ensure("empty", image.empty());
+        ensure("alive_set empty", image.alive_set().empty());
+        ensure_equals("header page", image.bytes(),
+                algorithm::ring_image::page_size());
+        ensure_THROW(image.hash(0.5), std::domain_error);
+        ensure_THROW(algorithm::ring_image("/nonexistent/ring"),
+                std::runtime_error);
+    }
+
+    template<>
+    template<>
+    void fixture::test<2>()
+    {
+        set_test_name("same owners as const_hash");
+        algorithm::const_hash hash;
+        for(int id = 0; id < 30; ++id)
+        {
+            hash.add(id, 70);
+        }
+        hash.erase(11);
+        algorithm::ring_image::save(hash, path.c_str());
+        algorithm::ring_image image(path.c_str());
+
+        ensure_equals("size", image.size(), hash.size());
+        ensure("alive_set", image.alive_set() == hash.alive_set());
+        ensure_equals("page aligned", image.bytes()
+                % algorithm::ring_image::page_size(), 0u);
+        for(int i = 0; i < 20000; ++i)
+        {
+            uint64_t k = key();
+            ensure_equals("key", image.hash_key(k), hash.hash_key(k));
+            ensure_equals("bytes", image.hash_key(&k, sizeof(k)),
+                    hash.hash_key(&k, sizeof(k)));
+        }
+        for(double r = 0; r <= 1; r += 0.001)
+        {
+            ensure_equals("resource", image.hash(r), hash.hash(r));
+        }
+        ensure_equals("last point", image.hash(1.0), hash.hash(1.0));
+        ensure_THROW(image.hash(2), std::range_error);
+    }
+
+    template<>
+    template<>
+    void fixture::test<3>()
+    {
+        set_test_name("damaged image");
+        algorithm::const_hash hash;
+        for(int id = 0; id < 5; ++id)
+        {
+            hash.add(id, 100);
+        }
+        algorithm::ring_image::save(hash, path.c_str());
+
+        // a flipped owner byte is only caught by the checksum.
+        corrupt(algorithm::ring_image::page_size() * 2 + 5);
+        ensure_THROW(algorithm::ring_image(path.c_str()),
+                std::runtime_error);
+        algorithm::ring_image unchecked(path.c_str(), false);
+        ensure_equals("unchecked size", unchecked.size(), hash.size());
+
+        algorithm::ring_image::save(hash, path.c_str());
+        corrupt(0);
+        ensure_THROW(algorithm::ring_image(path.c_str(), false),
+                std::runtime_error);
+
+        algorithm::ring_image::save(hash, path.c_str());
+        corrupt(12);
+        ensure_THROW(algorithm::ring_image(path.c_str(), false),
+                std::runtime_error);
+
+        std::FILE* file = std::fopen(path.c_str(), "wb");
+        std::fputs("short", file);
+        std::fclose(file);
+        ensure_THROW(algorithm::ring_image(path.c_str()),
+                std::runtime_error);
+    }
+
+    template<>
+    template<>
+    void fixture::test<4>()
+    {
+        set_test_name("concurrent writers");
+        algorithm::const_hash first, second;
+        for(int id = 0; id < 10; ++id)
+        {
+            first.add(id, 50);
+            second.add(id + 20, 60);
+        }
+
+        const int count = 4;
+        pid_t children[count];
+        for(int i = 0; i < count; ++i)
+        {
+            children[i] = fork();
+            if(children[i] == 0)
+            {
+                int status = 0;
+                try
+                {
+                    for(int round = 0; round < 50; ++round)
+                    {
+                        algorithm::ring_image::save(i % 2 ? first : second,
+                                path.c_str());
+                    }
+                }
+                catch(...)
+                {
+                    status = 1;
+                }
+                _exit(status);
+            }
+        }
+        for(int i = 0; i < count; ++i)
+        {
+            int status = -1;
+            waitpid(children[i], &status, 0);
+            ensure("writer exited", WIFEXITED(status));
+            ensure_equals("writer saved", WEXITSTATUS(status), 0);
+        }
+
+        algorithm::ring_image image(path.c_str());
+        ensure("one of the rings", image.alive_set() == first.alive_set()
+                || image.alive_set() == second.alive_set());
+
+        // no temporary file is left beside the image.
+        std::string directory = path.substr(0, path.rfind('/'));
+        std::string prefix = path.substr(path.rfind('/') + 1) + ".";
+        int leftover = 0;
+        DIR* dir = opendir(directory.c_str());
+        for(dirent* entry = readdir(dir); entry; entry = readdir(dir))
+        {
+            leftover += std::string(entry->d_name).compare(0, prefix.size(),
+                    prefix) == 0;
+        }
+        closedir(dir);
+        ensure_equals("no temporary files", leftover, 0);
+    }
+}
@@ -0,0 +1,167 @@
+#include "algorithm/ringsearch.hpp"
+#include "algorithm/flatring.hpp"
+#include "tut/tut.hpp"
+#include "tut/tut_macros.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <map>
+#include <vector>
+
+namespace
+{
+    struct data
+    {
+        uint32_t random()
+        {
+            return ((uint32_t)rand() << 16) ^ (uint32_t)rand();
+        }
+
+        std::vector<algorithm::ring_search::count_function> kernels()
+        {
+            std::vector<algorithm::ring_search::count_function> result;
+            result.push_back(algorithm::ring_search::count_less_scalar);
+#ifdef RING_SEARCH_X86
+            __builtin_cpu_init();
+            if(__builtin_cpu_supports("sse4.2"))
+            {
+                result.push_back(algorithm::ring_search::count_less_sse42);
+            }
+            if(__builtin_cpu_supports("avx2"))
+            {
+                result.push_back(algorithm::ring_search::count_less_avx2);
+            }
+            if(__builtin_cpu_supports("avx512f"))
+            {
+                result.push_back(algorithm::ring_search::count_less_avx512);
+            }
+#endif
+            return result;
+        }
+    };
+    typedef tut::test_group<data> group;
+    group g("ring_search");
+
+    typedef group::object fixture;
+}
+
+namespace tut
+{
+    template<>
+    template<>
+    void fixture::test<1>()
+    {
+        set_test_name("kernels match scalar count");
+        std::vector<algorithm::ring_search::count_function> all = kernels();
+        uint32_t points[algorithm::ring_search::window];
+        for(int loop = 0; loop < 1000; ++loop)
+        {
+            for(int i = 0; i < algorithm::ring_search::window; ++i)
+            {
+                points[i] = random();
+            }
+            if(loop % 2)
+            {
+                points[loop % algorithm::ring_search::window] = 0xFFFFFFFFu;
+                points[(loop + 3) % algorithm::ring_search::window] = 0;
+            }
+            std::sort(points, points + algorithm::ring_search::window);
+
+            uint32_t keys[] = {0, 1, 0x7FFFFFFFu, 0x80000000u, 0xFFFFFFFFu,
+                points[loop % algorithm::ring_search::window], random()};
+            for(size_t k = 0; k < sizeof(keys)/sizeof(keys[0]); ++k)
+            {
+                std::size_t expected = std::lower_bound(points,
+                        points + algorithm::ring_search::window, keys[k])
+                    - points;
+                for(size_t i = 0; i < all.size(); ++i)
+                {
+                    ensure_equals("kernel count", all[i](points, keys[k]),
+                            expected);
+                }
+                ensure_equals("dispatched count",
+                        algorithm::ring_search::count_less(points, keys[k]),
+                        expected);
+            }
+        }
+    }
+
+    template<>
+    template<>
+    void fixture::test<2>()
+    {
+        set_test_name("flat ring lower_bound matches std::lower_bound");
+        for(int size = 0; size < 200; ++size)
+        {
+            std::map<uint32_t, int> ring;
+            while((int)ring.size() < size)
+            {
+                ring.insert(std::make_pair(random(), (int)ring.size()));
+            }
+            std::vector<uint32_t> points;
+            for(std::map<uint32_t, int>::const_iterator it = ring.begin();
+                    it != ring.end(); ++it)
+            {
+                points.push_back(it->first);
+            }
+            algorithm::flat_ring<uint32_t> flat;
+            flat.assign(ring.begin(), ring.end());
+
+            std::vector<uint32_t> keys;
+            keys.push_back(0);
+            keys.push_back(0xFFFFFFFFu);
+            for(size_t i = 0; i < points.size(); ++i)
+            {
+                keys.push_back(points[i]);
+                keys.push_back(points[i] - 1);
+                keys.push_back(points[i] + 1);
+            }
+            for(size_t i = 0; i < keys.size(); ++i)
+            {
+                std::size_t expected = std::lower_bound(points.begin(),
+                        points.end(), keys[i]) - points.begin();
+                ensure_equals("lower_bound", flat.lower_bound(keys[i]),
+                        expected);
+            }
+        }
+    }
+
+    template<>
+    template<>
+    void fixture::test<3>()
+    {
+        set_test_name("eytzinger ring successor matches sorted ring");
+        for(int size = 1; size < 200; ++size)
+        {
+            std::map<uint32_t, int> ring;
+            while((int)ring.size() < size)
+            {
+                ring.insert(std::make_pair(random(), (int)ring.size()));
+            }
+            algorithm::eytzinger_ring<uint32_t> eytzinger;
+            eytzinger.assign(ring.begin(), ring.end());
+            ensure_equals("size", eytzinger.size(), ring.size());
+
+            std::vector<uint32_t> keys;
+            keys.push_back(0);
+            keys.push_back(0xFFFFFFFFu);
+            for(std::map<uint32_t, int>::const_iterator it = ring.begin();
+                    it != ring.end(); ++it)
+            {
+                keys.push_back(it->first);
+                keys.push_back(it->first - 1);
+                keys.push_back(it->first + 1);
+            }
+            for(size_t i = 0; i < keys.size(); ++i)
+            {
+                std::map<uint32_t, int>::const_iterator it =
+                    ring.lower_bound(keys[i]);
+                if(it == ring.end())
+                {
+                    it = ring.begin();
+                }
+                ensure_equals("successor", eytzinger.successor(keys[i]),
+                        it->second);
+            }
+        }
+    }
+}
@@ -0,0 +1,273 @@
+#include "algorithm/sharedring.hpp"
+#include "tut/tut.hpp"
+#include "tut/tut_macros.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace
+{
+    struct data
+    {
+        data()
+        {
+            char buffer[64];
+            std::sprintf(buffer, "/sharedring_test_%d", (int)getpid());
+            name = buffer;
+        }
+
+        ~data()
+        {
+            algorithm::shared_ring::unlink(name.c_str());
+        }
+
+        uint64_t key()
+        {
+            return ((uint64_t)rand() << 32) | rand();
+        }
+
+        std::string name;
+    };
+    typedef tut::test_group<data> group;
+    group g("shared_ring");
+
+    typedef group::object fixture;
+
+    // what the reader threads share: the worker ring, the two rings
+    // the updater alternates between, and when to stop.
+    struct lookups
+    {
+        const algorithm::shared_ring* ring;
+        const algorithm::const_hash* first;
+        const algorithm::const_hash* second;
+        bool stop;
+        long wrong;
+    };
+
+    // counts answers that neither published ring would give.
+    void* read(void* arg)
+    {
+        lookups* l = static_cast<lookups*>(arg);
+        long wrong = 0;
+        uint64_t key = (uint64_t)pthread_self();
+        while(!__atomic_load_n(&l->stop, __ATOMIC_ACQUIRE))
+        {
+            key = key * 6364136223846793005ull + 1442695040888963407ull;
+            int id = l->ring->hash_key(key);
+            wrong += id != l->first->hash_key(key)
+                && id != l->second->hash_key(key);
+        }
+        __atomic_add_fetch(&l->wrong, wrong, __ATOMIC_RELAXED);
+        return NULL;
+    }
+}
+
+namespace tut
+{
+    template<>
+    template<>
+    void fixture::test<1>()
+    {
+        set_test_name("construct object");
+        ensure_THROW(algorithm::shared_ring(name.c_str()),
+                std::runtime_error);
+        ensure_THROW(algorithm::shared_ring(name.c_str(), 0),
+                std::range_error);
+
+        algorithm::shared_ring updater(name.c_str(), 100);
+        algorithm::shared_ring worker(name.c_str());
+        ensure("empty", worker.empty());
+        ensure("alive_set empty", worker.alive_set().empty());
+        ensure_equals("capacity", worker.capacity(), 100u);
+        ensure_equals("generation", worker.generation(), 0u);
+        ensure_THROW(worker.hash(0.5), std::domain_error);
+
+        algorithm::const_hash hash;
+        hash.add(1, 101);
+        ensure_THROW(updater.publish(hash), std::range_error);
+    }
+
+    template<>
+    template<>
+    void fixture::test<2>()
+    {
+        set_test_name("publish to other processes");
+        algorithm::const_hash hash;
+        for(int id = 0; id < 20; ++id)
+        {
+            hash.add(id, 50);
+        }
+        algorithm::shared_ring updater(name.c_str(), 2000);
+        algorithm::shared_ring worker(name.c_str());
+        updater.publish(hash);
+        ensure_equals("generation", worker.generation(), 1u);
+        ensure_equals("size", worker.size(), hash.size());
+        ensure("alive_set", worker.alive_set() == hash.alive_set());
+
+        hash.erase(4);
+        hash.add(30, 40);
+        updater.publish(hash);
+        ensure_equals("second generation", worker.generation(), 2u);
+        ensure("second alive_set", worker.alive_set() == hash.alive_set());
+        for(int i = 0; i < 10000; ++i)
+        {
+            uint64_t k = key();
+            ensure_equals("key", worker.hash_key(k), hash.hash_key(k));
+        }
+        for(double r = 0; r <= 1; r += 0.001)
+        {
+            ensure_equals("resource", worker.hash(r), hash.hash(r));
+        }
+
+        // a forked worker attaching on its own sees the same ring.
+        pid_t child = fork();
+        if(child == 0)
+        {
+            int status = 0;
+            try
+            {
+                algorithm::shared_ring attached(name.c_str());
+                for(uint64_t k = 0; k < 10000; ++k)
+                {
+                    status |= attached.hash_key(k) != hash.hash_key(k);
+                }
+            }
+            catch(...)
+            {
+                status = 2;
+            }
+            _exit(status);
+        }
+        int status = -1;
+        waitpid(child, &status, 0);
+        ensure("child exited", WIFEXITED(status));
+        ensure_equals("child lookups", WEXITSTATUS(status), 0);
+    }
+
+    template<>
+    template<>
+    void fixture::test<3>()
+    {
+        set_test_name("readers during updates");
+        algorithm::const_hash first, second;
+        for(int id = 0; id < 10; ++id)
+        {
+            first.add(id, 40);
+            second.add(id + 5, 40);
+        }
+        algorithm::shared_ring updater(name.c_str(), 1000);
+        algorithm::shared_ring worker(name.c_str());
+        updater.publish(first);
+
+        lookups shared = {&worker, &first, &second, false, 0};
+        const int count = 4;
+        pthread_t threads[count];
+        for(int i = 0; i < count; ++i)
+        {
+            pthread_create(&threads[i], NULL, read, &shared);
+        }
+        for(int round = 0; round < 2000; ++round)
+        {
+            updater.publish(round % 2 ? first : second);
+        }
+        __atomic_store_n(&shared.stop, true, __ATOMIC_RELEASE);
+        for(int i = 0; i < count; ++i)
+        {
+            pthread_join(threads[i], NULL);
+        }
+        ensure_equals("no torn lookups", shared.wrong, 0);
+        ensure_equals("generation", worker.generation(), 2001u);
+    }
+
+    template<>
+    template<>
+    void fixture::test<4>()
+    {
+        set_test_name("restarted updater");
+        algorithm::const_hash hash;
+        for(int id = 0; id < 10; ++id)
+        {
+            hash.add(id, 20);
+        }
+        algorithm::shared_ring* updater =
+            new algorithm::shared_ring(name.c_str(), 500);
+        algorithm::shared_ring worker(name.c_str());
+        updater->publish(hash);
+        delete updater;
+
+        // the same capacity attaches, keeping ring and generation.
+        algorithm::shared_ring restarted(name.c_str(), 500);
+        ensure_equals("generation kept", worker.generation(), 1u);
+        ensure_equals("size kept", worker.size(), hash.size());
+        uint64_t k = key();
+        ensure_equals("key", worker.hash_key(k), hash.hash_key(k));
+
+        ensure_THROW(algorithm::shared_ring(name.c_str(), 1000),
+                std::runtime_error);
+        ensure_THROW(algorithm::shared_ring(name.c_str(), 100),
+                std::runtime_error);
+        ensure_equals("worker unaffected", worker.hash_key(k), hash.hash_key(k));
+
+        hash.erase(3);
+        restarted.publish(hash);
+        ensure_equals("next generation", worker.generation(), 2u);
+        ensure("alive_set", worker.alive_set() == hash.alive_set());
+        for(int i = 0; i < 1000; ++i)
+        {
+            k = key();
+            ensure_equals("key", worker.hash_key(k), hash.hash_key(k));
+        }
+    }
+
+    template<>
+    template<>
+    void fixture::test<5>()
+    {
+        set_test_name("updater died inside publish");
+        algorithm::const_hash hash;
+        for(int id = 0; id < 10; ++id)
+        {
+            hash.add(id, 20);
+        }
+        algorithm::shared_ring* updater =
+            new algorithm::shared_ring(name.c_str(), 500);
+        algorithm::shared_ring worker(name.c_str());
+        updater->publish(hash);
+        delete updater;
+
+        // what an updater killed between starting and finishing a
+        // publish() leaves: the generation counter, after magic,
+        // version and capacity, stays odd.
+        int fd = ::shm_open(name.c_str(), O_RDWR, 0);
+        ensure("open", fd >= 0);
+        void* segment = ::mmap(NULL, 64, PROT_READ | PROT_WRITE, MAP_SHARED,
+                fd, 0);
+        ::close(fd);
+        ensure("map", segment != MAP_FAILED);
+        uint64_t* generation = static_cast<uint64_t*>(segment) + 3;
+        __atomic_store_n(generation, (uint64_t)3, __ATOMIC_RELEASE);
+        uint64_t k = key();
+        ensure_equals("still readable", worker.hash_key(k), hash.hash_key(k));
+
+        algorithm::shared_ring restarted(name.c_str(), 500);
+        ensure_equals("even again",
+                __atomic_load_n(generation, __ATOMIC_ACQUIRE), 2u);
+        ensure_equals("generation kept", worker.generation(), 1u);
+        ensure_equals("key", worker.hash_key(k), hash.hash_key(k));
+
+        hash.erase(3);
+        restarted.publish(hash);
+        ensure_equals("next generation", worker.generation(), 2u);
+        for(int i = 0; i < 1000; ++i)
+        {
+            k = key();
+            ensure_equals("key", worker.hash_key(k), hash.hash_key(k));
+        }
+        ::munmap(segment, 64);
+    }
+}
@@ -0,0 +1,156 @@
+#include "algorithm/staticring.hpp"
+#include "tut/tut.hpp"
+#include "tut/tut_macros.hpp"
+#include <cstdlib>
+
+#if __cplusplus >= 201402L
+namespace
+{
+    constexpr algorithm::static_node nodes[] = {
+        {1, 40}, {2, 60}, {3, 50}, {5, 45}, {8, 70},
+        {13, 35}, {21, 55}, {3, 20}, {34, 0}, {55, 65}
+    };
+    constexpr algorithm::static_ring<algorithm::static_ring_size(nodes)>
+        ring = algorithm::make_static_ring<
+            algorithm::static_ring_size(nodes)>(nodes);
+
+    // built and searched entirely by the compiler.
+    static_assert(ring.size() == 440, "every weight is placed");
+    static_assert(ring.successor(ring.point(7)) == ring.owner(7),
+            "a point belongs to its owner");
+
+    // a cluster of realistic size, within the default constexpr limits.
+    struct cluster
+    {
+        algorithm::static_node nodes[64];
+    };
+
+    constexpr cluster make_cluster()
+    {
+        cluster c{};
+        for(int i = 0; i < 64; ++i)
+        {
+            c.nodes[i].id = 1000 + 7 * i;
+            c.nodes[i].weight = 256;
+        }
+        return c;
+    }
+
+    constexpr cluster large = make_cluster();
+    constexpr algorithm::static_ring<
+        algorithm::static_ring_size(large.nodes)>
+        large_ring = algorithm::make_static_ring<
+            algorithm::static_ring_size(large.nodes)>(large.nodes);
+
+    static_assert(large_ring.size() == 64 * 256, "every weight is placed");
+    static_assert(large_ring.successor(large_ring.point(4321))
+            == large_ring.owner(4321), "a point belongs to its owner");
+
+    struct data
+    {
+        uint64_t key()
+        {
+            return ((uint64_t)rand() << 32) | rand();
+        }
+    };
+    typedef tut::test_group<data> group;
+    group g("static_ring");
+
+    typedef group::object fixture;
+}
+
+namespace tut
+{
+    template<>
+    template<>
+    void fixture::test<1>()
+    {
+        set_test_name("same ring as const_hash");
+        algorithm::const_hash hash;
+        for(std::size_t i = 0; i < sizeof(nodes) / sizeof(nodes[0]); ++i)
+        {
+            hash.add(nodes[i].id, nodes[i].weight);
+        }
+        ensure_equals("size", ring.size(), hash.size());
+        std::size_t index = 0;
+        for(algorithm::const_hash::const_iterator it = hash.begin();
+                it != hash.end(); ++it, ++index)
+        {
+            ensure_equals("point", ring.point(index), it->first);
+            ensure_equals("owner", ring.owner(index), it->second);
+        }
+    }
+
+    template<>
+    template<>
+    void fixture::test<2>()
+    {
+        set_test_name("same owners as const_hash");
+        algorithm::const_hash hash;
+        for(std::size_t i = 0; i < sizeof(nodes) / sizeof(nodes[0]); ++i)
+        {
+            hash.add(nodes[i].id, nodes[i].weight);
+        }
+        for(int i = 0; i < 20000; ++i)
+        {
+            uint64_t k = key();
+            ensure_equals("key", ring.hash_key(k), hash.hash_key(k));
+            ensure_equals("bytes", ring.hash_key(&k, sizeof(k)),
+                    hash.hash_key(&k, sizeof(k)));
+        }
+        for(double r = 0; r <= 1; r += 0.001)
+        {
+            ensure_equals("resource", ring.hash(r), hash.hash(r));
+        }
+        ensure_equals("end of ring", ring.hash(1.0), hash.hash(1.0));
+        ensure_THROW(ring.hash(2), std::range_error);
+    }
+
+    template<>
+    template<>
+    void fixture::test<3>()
+    {
+        set_test_name("large map as const_hash");
+        algorithm::const_hash hash;
+        for(std::size_t i = 0; i < 64; ++i)
+        {
+            hash.add(large.nodes[i].id, large.nodes[i].weight);
+        }
+        ensure_equals("size", large_ring.size(), hash.size());
+        std::size_t index = 0;
+        for(algorithm::const_hash::const_iterator it = hash.begin();
+                it != hash.end(); ++it, ++index)
+        {
+            ensure_equals("point", large_ring.point(index), it->first);
+            ensure_equals("owner", large_ring.owner(index), it->second);
+        }
+    }
+
+    template<>
+    template<>
+    void fixture::test<4>()
+    {
+        set_test_name("colliding points as const_hash");
+        // node 8 hits a point taken earlier, at sequence 7693.
+        static const algorithm::static_node colliding[] = {
+            {1, 8192}, {2, 8192}, {3, 8192}, {4, 8192},
+            {5, 8192}, {6, 8192}, {7, 8192}, {8, 8192}
+        };
+        static const algorithm::static_ring<8 * 8192> built =
+            algorithm::make_static_ring<8 * 8192>(colliding);
+        algorithm::const_hash hash;
+        for(std::size_t i = 0; i < 8; ++i)
+        {
+            hash.add(colliding[i].id, colliding[i].weight);
+        }
+        ensure_equals("size", built.size(), hash.size());
+        std::size_t index = 0;
+        for(algorithm::const_hash::const_iterator it = hash.begin();
+                it != hash.end(); ++it, ++index)
+        {
+            ensure_equals("point", built.point(index), it->first);
+            ensure_equals("owner", built.owner(index), it->second);
+        }
+    }
+}
+#endif